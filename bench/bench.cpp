@@ -0,0 +1,255 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "column_judge.hpp"
+#include "shogi.hpp"
+#include "slider_attack.hpp"
+
+using namespace komori;
+
+void help_and_exit(char* argv[]) {
+  std::printf("usage: %s replay_file [sec]\n", argv[0]);
+  std::printf("replay_file : inputs written by --capture-judge\n");
+  std::printf("sec         : the minimum time of each benchmark (default: 0.5)\n");
+  std::exit(EXIT_FAILURE);
+}
+
+namespace {
+/// The minimum time of each benchmark without `sec`
+constexpr double kDefaultSeconds = 0.5;
+/// The results of the benchmarks are added to it so that the compiler does not remove them
+volatile u64 g_sink;
+
+/**
+ * @brief Call `func` repeatedly for at least `sec` seconds and print the time per operation
+ *
+ * @param ops The number of operations in a call of `func`
+ */
+template <typename Func>
+void Measure(const char* name, u64 ops, double sec, Func&& func) {
+  using Clock = std::chrono::steady_clock;
+  u64 sum = 0;
+  u64 rounds = 0;
+  double elapsed = 0;
+  auto start = Clock::now();
+  do {
+    sum += func();
+    ++rounds;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < sec);
+  g_sink = g_sink + sum;
+
+  double ns = elapsed * 1e9 / static_cast<double>(rounds * ops);
+  std::printf("%-20s %14" PRIu64 " ops %10.2f ns/op %10.2f Mops/s\n", name, rounds * ops, ns, 1e3 / ns);
+}
+
+/**
+ * @brief Check the effects stopped at the first piece against `AttackBB` on the occupancies of `inputs`
+ *
+ * They are the same on empty lines, and a piece effected by one is effected by the other. The search relies on the
+ * latter, so that it never has to stop the effects of sliders.
+ */
+template <int F, int R>
+bool CheckSliderAttack(const std::vector<BasicJudgeInput<F, R>>& inputs) {
+  using Bitboard = BasicBitboard<F, R>;
+  constexpr int kSquareNum = Board<F, R>::kSquareNum;
+  for (int pc = 0; pc < PCNum; ++pc) {
+    for (Square sq = 0; sq < kSquareNum; ++sq) {
+      Bitboard attack = AttackBB<F, R>(PieceType(pc), sq);
+      if (!(BlockedAttackBB<F, R>(PieceType(pc), sq, allZeroBB<F, R>()) == attack)) {
+        std::printf("slider attack mismatch: piece %d at %d on the empty board\n", pc, sq);
+        return false;
+      }
+      for (const auto& input : inputs) {
+        Bitboard blocked = BlockedAttackBB<F, R>(PieceType(pc), sq, input.pieces_bb);
+        if (blocked.andIsAny(~attack) || blocked.andIsAny(input.pieces_bb) != attack.andIsAny(input.pieces_bb)) {
+          std::printf("slider attack mismatch: piece %d at %d with %s\n", pc, sq,
+                      Bitboard2String(input.pieces_bb).c_str());
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <int F, int R>
+int BenchMain(const std::vector<std::string>& lines, double sec) {
+  using Bitboard = BasicBitboard<F, R>;
+  constexpr int kSquareNum = Board<F, R>::kSquareNum;
+  constexpr PieceType kPieces[] = {BlackPawn,  BlackLance, BlackKnight, BlackSilver, BlackGold,
+                                   BlackBishop, BlackRook, BlackKing,   WhitePawn,   WhiteKnight};
+  constexpr int kPieceNum = sizeof(kPieces) / sizeof(kPieces[0]);
+  InitColumnTable<F, R>();
+
+  std::vector<BasicJudgeInput<F, R>> inputs;
+  std::vector<BasicJudgeInput<F, R>> mixed_inputs;
+  for (const auto& line : lines) {
+    inputs.push_back(String2JudgeInput<F, R>(line));
+    if (inputs.back().kind == kColumnMixed) {
+      mixed_inputs.push_back(inputs.back());
+    }
+  }
+
+  // The placements for `Pieces2Sfen` put pieces on the occupied squares of the inputs
+  std::vector<PiecePositions> placements;
+  u64 square_cnt = 0;
+  u64 judged_cnt = 0;
+  for (const auto& input : inputs) {
+    PiecePositions pieces;
+    Bitboard pieces_bb = input.pieces_bb;
+    while (pieces_bb.isAny()) {
+      Square sq = pieces_bb.firstOneFromSQ11();
+      pieces.push_back({kPieces[pieces.size() % kPieceNum], sq});
+    }
+    placements.push_back(std::move(pieces));
+    square_cnt += input.no_effect_bb.popCount();
+    judged_cnt += JudgeColumns(input);
+  }
+  std::printf("inputs %zu (mixed %zu) placeable %.1f%%\n", inputs.size(), mixed_inputs.size(),
+              100.0 * judged_cnt / inputs.size());
+
+  u64 n = inputs.size();
+  Measure("andIsAny", n, sec, [&] {
+    u64 sum = 0;
+    for (const auto& input : inputs) {
+      sum += input.no_effect_bb.andIsAny(input.pieces_bb);
+    }
+    return sum;
+  });
+  Measure("popCount", n, sec, [&] {
+    u64 sum = 0;
+    for (const auto& input : inputs) {
+      sum += input.no_effect_bb.popCount();
+    }
+    return sum;
+  });
+  Measure("firstOneFromSQ11", std::max<u64>(square_cnt, 1), sec, [&] {
+    u64 sum = 0;
+    for (const auto& input : inputs) {
+      Bitboard bb = input.no_effect_bb;
+      while (bb.isAny()) {
+        sum += bb.firstOneFromSQ11();
+      }
+    }
+    return sum;
+  });
+  Measure("up/down", n, sec, [&] {
+    u64 sum = 0;
+    for (const auto& input : inputs) {
+      sum += input.no_effect_bb.template down<Black>().andIsAny(input.pieces_bb.template up<White>());
+    }
+    return sum;
+  });
+  Measure("AttackBB", n, sec, [&] {
+    u64 sum = 0;
+    for (u64 i = 0; i < n; ++i) {
+      sum += AttackBB<F, R>(kPieces[i % kPieceNum], i % kSquareNum).andIsAny(inputs[i].no_effect_bb);
+    }
+    return sum;
+  });
+  // The effects of sliders are looked up with the occupied squares of the inputs
+  InitSliderAttack<F, R>();
+  if (!CheckSliderAttack(inputs)) {
+    return EXIT_FAILURE;
+  }
+  const auto& slider_table = kSliderTable<F, R>;
+#ifdef __BMI2__
+  Measure("LineAttack (pext)", n, sec, [&] {
+    u64 sum = 0;
+    for (u64 i = 0; i < n; ++i) {
+      const auto& entry = slider_table.entries[i % kSliderLineNum][i % kSquareNum];
+      sum += slider_table.pext_attacks[PextIndex(entry, inputs[i].pieces_bb)].andIsAny(inputs[i].no_effect_bb);
+    }
+    return sum;
+  });
+#endif
+  Measure("LineAttack (magic)", n, sec, [&] {
+    u64 sum = 0;
+    for (u64 i = 0; i < n; ++i) {
+      const auto& entry = slider_table.entries[i % kSliderLineNum][i % kSquareNum];
+      sum += slider_table.magic_attacks[MagicIndex(entry, inputs[i].pieces_bb)].andIsAny(inputs[i].no_effect_bb);
+    }
+    return sum;
+  });
+  Measure("BlockedAttackBB", n, sec, [&] {
+    u64 sum = 0;
+    for (u64 i = 0; i < n; ++i) {
+      PieceType pc = kPieces[i % kPieceNum];
+      sum += BlockedAttackBB<F, R>(pc, i % kSquareNum, inputs[i].pieces_bb).andIsAny(inputs[i].no_effect_bb);
+    }
+    return sum;
+  });
+  Measure("JudgeColumns", n, sec, [&] {
+    u64 sum = 0;
+    for (const auto& input : inputs) {
+      sum += JudgeColumns(input);
+    }
+    return sum;
+  });
+  if (!mixed_inputs.empty()) {
+    Measure("GetColumnPlacement", mixed_inputs.size(), sec, [&] {
+      u64 sum = 0;
+      Bitboard pawn_b, pawn_w, stone_bb;
+      for (const auto& input : mixed_inputs) {
+        sum += GetColumnPlacement(input.no_effect_bb, input.pieces_bb, input.pawn, input.stone, input.lance, pawn_b,
+                                  pawn_w, stone_bb);
+      }
+      return sum;
+    });
+  }
+  Measure("Pieces2Sfen", n, sec, [&] {
+    u64 sum = 0;
+    for (const auto& pieces : placements) {
+      sum += Pieces2Sfen<F, R>(pieces).size();
+    }
+    return sum;
+  });
+  return EXIT_SUCCESS;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    help_and_exit(argv);
+  }
+  double sec = argc >= 3 ? std::stod(std::string{argv[2]}) : kDefaultSeconds;
+
+  std::ifstream ifs(argv[1]);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  if (lines.empty()) {
+    std::printf("no inputs in %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  // Every line has the board size as the second word (e.g. "judge 9x9 ...")
+  int file_num = 0;
+  int rank_num = 0;
+  std::sscanf(lines[0].c_str(), "%*s %dx%d", &file_num, &rank_num);
+  try {
+#define KOMORI_DISPATCH(F, R)           \
+  if (file_num == F && rank_num == R) { \
+    return BenchMain<F, R>(lines, sec); \
+  }
+    KOMORI_FOR_EACH_BOARD(KOMORI_DISPATCH)
+#undef KOMORI_DISPATCH
+  } catch (const std::runtime_error& e) {
+    std::printf("%s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  std::printf("unsupported board size: %dx%d\n", file_num, rank_num);
+  return EXIT_FAILURE;
+}
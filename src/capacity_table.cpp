@@ -0,0 +1,35 @@
+#include "screen.hpp"
+
+namespace komori {
+namespace {
+/**
+ * @brief The capacity tables generated by `--capacity-table`
+ *
+ * Each entry is the count which the search proved to be unplaceable within 60 seconds (9x9) or 10 seconds (the others),
+ * minus one. Lances facing one direction are bounded by the number of files instead, because the proof does not finish
+ * in time on 9x9. It is the exact maximum for most of the pieces, and an upper bound for the rest (e.g. knights, golds
+ * and kings on 9x9).
+ */
+constexpr CapacityTable kCapacityTables[] = {
+    // 9x9: P L N S G B R K +B +R Q
+    {9, 9, {{45, 54}, {9, 18}, {77, 77}, {45, 51}, {34, 41}, {16, 16}, {9, 9}, {31, 31}, {15, 15}, {9, 9}, {9, 9}}},
+    // 6x6: P L N S G B R K +B +R Q
+    {6, 6, {{18, 24}, {6, 12}, {24, 28}, {18, 18}, {9, 12}, {10, 10}, {6, 6}, {9, 9}, {9, 9}, {6, 6}, {6, 6}}},
+    // 5x6: P L N S G B R K +B +R Q
+    {5, 6, {{15, 20}, {5, 10}, {20, 22}, {15, 16}, {9, 11}, {10, 10}, {5, 5}, {9, 9}, {8, 8}, {5, 5}, {5, 5}}},
+    // 5x5: P L N S G B R K +B +R Q
+    {5, 5, {{15, 20}, {5, 10}, {16, 21}, {15, 15}, {9, 10}, {8, 8}, {5, 5}, {9, 9}, {7, 7}, {5, 5}, {5, 5}}},
+    // 3x4: P L N S G B R K +B +R Q
+    {3, 4, {{6, 9}, {3, 6}, {8, 12}, {6, 7}, {4, 5}, {6, 6}, {3, 3}, {4, 4}, {4, 4}, {3, 3}, {3, 3}}},
+};
+}  // namespace
+
+const CapacityTable* FindCapacityTable(int file_num, int rank_num) {
+  for (const auto& table : kCapacityTables) {
+    if (table.file_num == file_num && table.rank_num == rank_num) {
+      return &table;
+    }
+  }
+  return nullptr;
+}
+}  // namespace komori
@@ -0,0 +1,57 @@
+#include "column_judge.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace komori {
+namespace {
+constexpr char kJudgeInputTag[] = "judge";
+/// The characters representing `ColumnKind` (b: black, w: white, m: mixed)
+constexpr char kColumnKindChars[] = "bwm";
+}  // namespace
+
+template <int F, int R>
+std::string JudgeInput2String(const BasicJudgeInput<F, R>& input) {
+  std::ostringstream ss;
+  ss << kJudgeInputTag << " " << F << "x" << R << " " << kColumnKindChars[input.kind] << " "
+     << Bitboard2String(input.no_effect_bb) << " " << Bitboard2String(input.pieces_bb) << " "
+     << Bitboard2String(input.pawn_allowed) << " " << input.pawn << " " << input.stone;
+  if (input.lance > 0) {
+    ss << " " << input.lance;
+  }
+  return ss.str();
+}
+
+template <int F, int R>
+BasicJudgeInput<F, R> String2JudgeInput(const std::string& line) {
+  std::istringstream ss(line);
+  std::string tag, board, kind, no_effect, pieces, pawn_allowed;
+  BasicJudgeInput<F, R> input;
+  if (!(ss >> tag >> board >> kind >> no_effect >> pieces >> pawn_allowed >> input.pawn >> input.stone) ||
+      tag != kJudgeInputTag || kind.size() != 1 || std::strchr(kColumnKindChars, kind[0]) == nullptr) {
+    throw std::runtime_error("broken judge input: " + line);
+  }
+  // The number of lances is omitted if it is 0
+  if (!(ss >> input.lance)) {
+    input.lance = 0;
+  } else if (input.lance < 0) {
+    throw std::runtime_error("broken judge input: " + line);
+  }
+  if (board != std::to_string(F) + "x" + std::to_string(R)) {
+    throw std::runtime_error("board size mismatch: " + board);
+  }
+
+  input.kind = ColumnKind(std::strchr(kColumnKindChars, kind[0]) - kColumnKindChars);
+  input.no_effect_bb = String2Bitboard<F, R>(no_effect);
+  input.pieces_bb = String2Bitboard<F, R>(pieces);
+  input.pawn_allowed = String2Bitboard<F, R>(pawn_allowed);
+  return input;
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                    \
+  template std::string JudgeInput2String<F, R>(const BasicJudgeInput<F, R>& input); \
+  template BasicJudgeInput<F, R> String2JudgeInput<F, R>(const std::string& line);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
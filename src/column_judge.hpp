@@ -0,0 +1,350 @@
+#ifndef KOMORI_COLUMN_JUDGE_HPP_
+#define KOMORI_COLUMN_JUDGE_HPP_
+
+#include <algorithm>
+#include <string>
+
+#include "column_table.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+/**
+ * @brief The slow part of `JudgeColumns`, which looks up the column table
+ *
+ * Pawn-like pieces in the files where `pawn_allowed` has no squares are given up. The number of stones is already
+ * checked if `kind` is not `kColumnMixed`.
+ */
+template <int F, int R>
+bool JudgeColumnsByTable(ColumnKind kind,
+                         const BasicBitboard<F, R>& no_effect_bb,
+                         const BasicBitboard<F, R>& pieces_bb,
+                         const BasicBitboard<F, R>& pawn_allowed,
+                         int pawn,
+                         int stone,
+                         int lance) {
+  const auto& table = kColumnTable<F, R>;
+  int state[F];
+  int max_pawn[F];
+  int pawn_sum = 0;
+  int stone_sum = 0;
+  int lance_sum = 0;
+  for (int f = 0; f < F; ++f) {
+    u64 empty = no_effect_bb.fileBits(f);
+    if (pawn_allowed.fileBits(f) == 0) {
+      state[f] = -1;
+      max_pawn[f] = 0;
+      stone_sum += Count1s(empty);
+    } else {
+      state[f] = table.ternary[empty] + 2 * table.ternary[pieces_bb.fileBits(f)];
+      max_pawn[f] = table.max_pawn[kind][state[f]];
+      pawn_sum += max_pawn[f];
+      stone_sum += table.max_stone[kind][state[f]][max_pawn[f]];
+      if (lance > 0) {
+        for (int l = kColumnMaxLance; l > 0; --l) {
+          if (table.max_stone_lance[state[f]][l][l] >= 0) {
+            lance_sum += l;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  int surplus = pawn_sum - pawn;
+  if (surplus < 0 || lance_sum < lance) {
+    return false;
+  } else if (lance > 0) {
+    // Knapsack: `most[k][l]` is the maximum number of stones when `k` pawns are given up in total and `l` pawns (at
+    // most `lance`) can be lances
+    int most[2][F * R + 1][kColumnMaxLance * F + 1];
+    int cur = 0;
+    for (int k = 0; k <= surplus; ++k) {
+      std::fill(most[cur][k], most[cur][k] + lance + 1, -1);
+    }
+    most[cur][0][0] = stone_sum;
+    for (int f = 0; f < F; ++f) {
+      if (state[f] < 0) {
+        continue;
+      }
+      const auto& max_stone = table.max_stone_lance[state[f]];
+      int base = max_stone[0][max_pawn[f]];
+      int next = cur ^ 1;
+      for (int k = 0; k <= surplus; ++k) {
+        std::fill(most[next][k], most[next][k] + lance + 1, -1);
+      }
+      for (int k = 0; k <= surplus; ++k) {
+        for (int l = 0; l <= lance; ++l) {
+          if (most[cur][k][l] < 0) {
+            continue;
+          }
+          for (int j = 0; j <= std::min(surplus - k, max_pawn[f]); ++j) {
+            for (int e = 0; e <= std::min(kColumnMaxLance, lance); ++e) {
+              if (max_stone[e][max_pawn[f] - j] >= 0) {
+                int& dst = most[next][k + j][std::min(l + e, lance)];
+                dst = std::max(dst, most[cur][k][l] + max_stone[e][max_pawn[f] - j] - base);
+              }
+            }
+          }
+        }
+      }
+      cur = next;
+    }
+    for (int k = 0; k <= surplus; ++k) {
+      if (most[cur][k][lance] >= stone) {
+        return true;
+      }
+    }
+    return false;
+  } else if (kind != kColumnMixed || stone_sum >= stone) {
+    return true;
+  } else if (surplus == 0) {
+    return false;
+  }
+
+  // Knapsack: `gain[k]` is the maximum number of extra stones when `k` pawns are given up in total
+  int gain[F * R + 1];
+  std::fill(gain, gain + surplus + 1, -1);
+  gain[0] = 0;
+  for (int f = 0; f < F; ++f) {
+    if (state[f] < 0) {
+      continue;
+    }
+    const std::int8_t* max_stone = table.max_stone[kind][state[f]];
+    int base = max_stone[max_pawn[f]];
+    for (int k = surplus; k > 0; --k) {
+      for (int j = 1; j <= std::min(k, max_pawn[f]); ++j) {
+        if (gain[k - j] >= 0) {
+          gain[k] = std::max(gain[k], gain[k - j] + max_stone[max_pawn[f] - j] - base);
+        }
+      }
+    }
+  }
+  return stone_sum + *std::max_element(gain, gain + surplus + 1) >= stone;
+}
+
+/**
+ * @brief Judge if `pawn` pawn-like pieces and `stone` stones are placeable in `no_effect_bb`
+ *
+ * Pawn-like pieces face the directions of `kind`, and they are placeable only in the files where `pawn_allowed` has a
+ * square. At least `lance` of them must be able to be lances, that is, no piece is in front of them in the file.
+ * `lance` must be 0 unless `kind` is `kColumnMixed`. The answer is exact except for the files where only a part of the
+ * squares are allowed.
+ */
+template <int F, int R>
+inline bool JudgeColumns(ColumnKind kind,
+                         const BasicBitboard<F, R>& no_effect_bb,
+                         const BasicBitboard<F, R>& pieces_bb,
+                         const BasicBitboard<F, R>& pawn_allowed,
+                         int pawn,
+                         int stone,
+                         int lance = 0) {
+  using Bitboard = BasicBitboard<F, R>;
+  int empty_num = no_effect_bb.popCount();
+  if (empty_num < pawn + stone) {
+    return false;
+  }
+
+  // Pawns whose front square is already effected take no squares from stones. Such pawns on the edge ranks of their
+  // directions can be lances, because the squares in front of them are not placeable.
+  Bitboard blocked_bb = no_effect_bb | pieces_bb;
+  Bitboard free_pawn_bb = allZeroBB<F, R>();
+  Bitboard free_lance_bb = allZeroBB<F, R>();
+  if (kind != kColumnWhite) {
+    Bitboard free_b = pawn_allowed & ~blocked_bb.template down<Black>();
+    free_pawn_bb |= free_b;
+    free_lance_bb |= free_b & Edge2BB<F, R>(Black);
+  }
+  if (kind != kColumnBlack) {
+    Bitboard free_w = pawn_allowed & ~blocked_bb.template down<White>();
+    free_pawn_bb |= free_w;
+    free_lance_bb |= free_w & Edge2BB<F, R>(White);
+  }
+  int free_pawn = free_pawn_bb.popCount();
+  if (free_pawn >= pawn && (lance == 0 || free_lance_bb.popCount() >= lance)) {
+    return true;
+  }
+
+  // Every other pawn also takes the square in front of it from stones. Facing either direction, two pawns may share it.
+  int taken = kind != kColumnMixed ? std::max(pawn - free_pawn, 0) : (std::max(pawn - free_pawn, 0) + 1) / 2;
+  if (empty_num - pawn - taken < stone) {
+    return false;
+  }
+
+  return JudgeColumnsByTable(kind, no_effect_bb, pieces_bb, pawn_allowed, pawn, stone, lance);
+}
+
+/// Get the pawn-like pieces of `pawn_b` (facing upward) and `pawn_w` (facing downward) which can be lances, that is, no
+/// piece of `occupied` is in front of them in the file
+template <int F, int R>
+BasicBitboard<F, R> LanceablePawns(BasicBitboard<F, R> pawn_b,
+                                   BasicBitboard<F, R> pawn_w,
+                                   const BasicBitboard<F, R>& occupied) {
+  BasicBitboard<F, R> lance_bb = allZeroBB<F, R>();
+  while (pawn_b.isAny()) {
+    Square sq = pawn_b.firstOneFromSQ11();
+    if (!AttackBB<F, R>(BlackLance, sq).andIsAny(occupied & ~SquareMaskBB<F, R>(sq))) {
+      lance_bb.setBit(sq);
+    }
+  }
+  while (pawn_w.isAny()) {
+    Square sq = pawn_w.firstOneFromSQ11();
+    if (!AttackBB<F, R>(WhiteLance, sq).andIsAny(occupied & ~SquareMaskBB<F, R>(sq))) {
+      lance_bb.setBit(sq);
+    }
+  }
+  return lance_bb;
+}
+
+/**
+ * @brief Get a placement of `pawn` pawn-like pieces (each facing either direction) and `stone` stones
+ *
+ * At least `lance` pawn-like pieces are placed so that lances can replace them, that is, no piece is in front of them
+ * in the file.
+ */
+template <int F, int R>
+bool GetColumnPlacement(BasicBitboard<F, R> no_effect_bb,
+                        BasicBitboard<F, R> pieces_bb,
+                        int pawn,
+                        int stone,
+                        int lance,
+                        BasicBitboard<F, R>& pawn_b,
+                        BasicBitboard<F, R>& pawn_w,
+                        BasicBitboard<F, R>& stone_bb) {
+  using Bitboard = BasicBitboard<F, R>;
+  using Geometry = Board<F, R>;
+  if (no_effect_bb.popCount() < pawn + stone || lance > kColumnMaxLance * F) {
+    return false;
+  }
+
+  const auto& table = kColumnTable<F, R>;
+  int state[F];
+  int pawn_sum = 0;
+  for (int f = 0; f < F; ++f) {
+    state[f] = table.ternary[no_effect_bb.fileBits(f)] + 2 * table.ternary[pieces_bb.fileBits(f)];
+    pawn_sum += table.max_pawn[kColumnMixed][state[f]];
+  }
+  int surplus = pawn_sum - pawn;
+  if (surplus < 0) {
+    return false;
+  }
+
+  // The same knapsack as `JudgeColumns`, which remembers the number of pawns given up and the number of pawns which can
+  // be lances in each file
+  struct Choice {
+    std::int8_t given_up;
+    std::int8_t lance;
+    std::int8_t prev_lance;
+  };
+  int most[F + 1][F * R + 1][kColumnMaxLance * F + 1];
+  Choice choice[F][F * R + 1][kColumnMaxLance * F + 1];
+  for (int k = 0; k <= surplus; ++k) {
+    std::fill(most[0][k], most[0][k] + lance + 1, -1);
+  }
+  most[0][0][0] = 0;
+  for (int f = 0; f < F; ++f) {
+    const auto& max_stone = table.max_stone_lance[state[f]];
+    int max_pawn = table.max_pawn[kColumnMixed][state[f]];
+    for (int k = 0; k <= surplus; ++k) {
+      std::fill(most[f + 1][k], most[f + 1][k] + lance + 1, -1);
+    }
+    for (int k = 0; k <= surplus; ++k) {
+      for (int l = 0; l <= lance; ++l) {
+        if (most[f][k][l] < 0) {
+          continue;
+        }
+        for (int j = 0; j <= std::min(surplus - k, max_pawn); ++j) {
+          for (int e = 0; e <= std::min(kColumnMaxLance, lance); ++e) {
+            int& dst = most[f + 1][k + j][std::min(l + e, lance)];
+            if (max_stone[e][max_pawn - j] >= 0 && most[f][k][l] + max_stone[e][max_pawn - j] > dst) {
+              dst = most[f][k][l] + max_stone[e][max_pawn - j];
+              choice[f][k + j][std::min(l + e, lance)] = {static_cast<std::int8_t>(j), static_cast<std::int8_t>(e),
+                                                          static_cast<std::int8_t>(l)};
+            }
+          }
+        }
+      }
+    }
+  }
+  int k = 0;
+  for (int i = 1; i <= surplus; ++i) {
+    if (most[F][i][lance] > most[F][k][lance]) {
+      k = i;
+    }
+  }
+  if (most[F][k][lance] < stone) {
+    return false;
+  }
+
+  pawn_b = allZeroBB<F, R>();
+  pawn_w = allZeroBB<F, R>();
+  stone_bb = allZeroBB<F, R>();
+  int pawn_num = 0;
+  int stone_num = 0;
+  int l = lance;
+  for (int f = F - 1; f >= 0; --f) {
+    Choice c = choice[f][k][l];
+    k -= c.given_up;
+    l = c.prev_lance;
+    int max_pawn = table.max_pawn[kColumnMixed][state[f]];
+    int file_stone = table.max_stone_lance[state[f]][c.lance][max_pawn - c.given_up];
+
+    ColumnPlacement placement;
+    pawn_num +=
+        SolveColumn(kColumnMixed, R, no_effect_bb.fileBits(f), pieces_bb.fileBits(f), file_stone, c.lance, placement);
+    for (int r = 0; r < R; ++r) {
+      Square sq = Geometry::MakeSquare(f, r);
+      if ((placement.pawn_b >> r) & 1) {
+        pawn_b.setBit(sq);
+      } else if ((placement.pawn_w >> r) & 1) {
+        pawn_w.setBit(sq);
+      } else if (((placement.stone >> r) & 1) && stone_num < stone) {
+        stone_bb.setBit(sq);
+        ++stone_num;
+      }
+    }
+  }
+
+  // Removing pieces keeps the placement valid, and it never makes a pawn unable to be a lance. Extra pawns which cannot
+  // be lances are removed first, and then the rest can be lances and are still at least `pawn`, which is not less than
+  // `lance`.
+  Bitboard lance_bb = LanceablePawns(pawn_b, pawn_w, pieces_bb | pawn_b | pawn_w | stone_bb);
+  for (Bitboard candidate_bb : {(pawn_b | pawn_w) & ~lance_bb, pawn_b | pawn_w}) {
+    while (pawn_num > pawn && candidate_bb.isAny()) {
+      Square sq = candidate_bb.firstOneFromSQ11();
+      if (pawn_b.isSet(sq) || pawn_w.isSet(sq)) {
+        pawn_b.clearBit(sq);
+        pawn_w.clearBit(sq);
+        --pawn_num;
+      }
+    }
+  }
+  return true;
+}
+
+/// The arguments of a call of `JudgeColumns`, which are captured from searches to replay them in benchmarks
+template <int F, int R>
+struct BasicJudgeInput {
+  ColumnKind kind{kColumnBlack};
+  BasicBitboard<F, R> no_effect_bb{};
+  BasicBitboard<F, R> pieces_bb{};
+  BasicBitboard<F, R> pawn_allowed{};
+  int pawn{0};
+  int stone{0};
+  int lance{0};
+};
+
+template <int F, int R>
+inline bool JudgeColumns(const BasicJudgeInput<F, R>& input) {
+  return JudgeColumns(input.kind, input.no_effect_bb, input.pieces_bb, input.pawn_allowed, input.pawn, input.stone,
+                      input.lance);
+}
+
+/// Get a string representing `input` in a line
+template <int F, int R>
+std::string JudgeInput2String(const BasicJudgeInput<F, R>& input);
+/// Parse a line written by `JudgeInput2String`. It throws `std::runtime_error` if the line is broken.
+template <int F, int R>
+BasicJudgeInput<F, R> String2JudgeInput(const std::string& line);
+}  // namespace komori
+
+#endif  // KOMORI_COLUMN_JUDGE_HPP_
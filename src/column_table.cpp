@@ -0,0 +1,251 @@
+#include "column_table.hpp"
+
+#include <algorithm>
+
+namespace komori {
+namespace {
+/// The number of pawn-like pieces of an impossible placement
+constexpr int kInfeasible = -1;
+
+/// The states of a square in a file
+enum SquareState { kSquareEffected, kSquareEmpty, kSquareOccupied, kSquareStateNum };
+/// What is placed on a square
+enum ColumnChoice { kChoiceNone, kChoiceStone, kChoicePawnB, kChoicePawnW };
+
+/// Flags of the scanned ranks: the last rank is occupied / the last rank has a pawn-like piece facing downward / no
+/// rank has a piece / a lance facing downward effects every rank below
+constexpr int kOccupiedFlag = 1;
+constexpr int kPawnWFlag = 2;
+constexpr int kClearFlag = 4;
+constexpr int kLanceWFlag = 8;
+constexpr int kFlagsNum = 16;
+/// The flags which can describe scanned ranks
+constexpr int kReachableFlags[] = {0, kOccupiedFlag, kOccupiedFlag | kPawnWFlag, kClearFlag, kLanceWFlag,
+                                   kOccupiedFlag | kLanceWFlag};
+
+/**
+ * @brief The most pawn-like pieces in the ranks scanned so far
+ *
+ * Ranks are scanned from the rank 0. `pawn[flags][s][l]` is the most pawn-like pieces with `s` stones, `l` of which
+ * can be lances, where `flags` describes the scanned ranks.
+ */
+struct ColumnLayer {
+  int pawn[kFlagsNum][kColumnMaxRank + 1][kColumnMaxLance + 1];
+};
+
+/// How each entry of a `ColumnLayer` is reached from the previous layer
+struct ColumnParent {
+  std::int8_t flags[kFlagsNum][kColumnMaxRank + 1][kColumnMaxLance + 1];
+  std::int8_t lance[kFlagsNum][kColumnMaxRank + 1][kColumnMaxLance + 1];
+  std::int8_t choice[kFlagsNum][kColumnMaxRank + 1][kColumnMaxLance + 1];
+};
+
+constexpr int kLayerSize = kFlagsNum * (kColumnMaxRank + 1) * (kColumnMaxLance + 1);
+
+void InitLayer(ColumnLayer& layer) {
+  std::fill(&layer.pawn[0][0][0], &layer.pawn[0][0][0] + kLayerSize, kInfeasible);
+  layer.pawn[kClearFlag][0][0] = 0;
+}
+
+/// Scan the rank `rank` whose state is `square`. It records how `next` is reached in `parent` if it is not null.
+void ScanRank(ColumnKind kind,
+              int rank,
+              SquareState square,
+              const ColumnLayer& prev,
+              ColumnLayer& next,
+              ColumnParent* parent) {
+  // Only the entries which can be reached are cleared, because this is the hot loop of building the tables
+  for (int flags : kReachableFlags) {
+    std::fill(&next.pawn[flags][0][0], &next.pawn[flags][0][0] + (rank + 2) * (kColumnMaxLance + 1), kInfeasible);
+  }
+  auto update = [&](int flags, int s, int l, int pawn, int prev_flags, int prev_l, ColumnChoice choice) {
+    if (pawn > next.pawn[flags][s][l]) {
+      next.pawn[flags][s][l] = pawn;
+      if (parent != nullptr) {
+        parent->flags[flags][s][l] = static_cast<std::int8_t>(prev_flags);
+        parent->lance[flags][s][l] = static_cast<std::int8_t>(prev_l);
+        parent->choice[flags][s][l] = static_cast<std::int8_t>(choice);
+      }
+    }
+  };
+
+  // Lances are counted only for the table of `max_stone_lance`
+  int max_lance = kind == kColumnMixed ? kColumnMaxLance : 0;
+  for (int prev_flags : kReachableFlags) {
+    bool effected = (prev_flags & (kPawnWFlag | kLanceWFlag)) != 0;
+    if (effected && square == kSquareOccupied) {
+      // The piece above effects the piece on this square
+      continue;
+    }
+
+    for (int s = 0; s <= rank; ++s) {
+      for (int l = 0; l <= max_lance; ++l) {
+        int pawn = prev.pawn[prev_flags][s][l];
+        if (pawn == kInfeasible) {
+          continue;
+        }
+
+        int none_flags = square == kSquareOccupied ? kOccupiedFlag : prev_flags & (kClearFlag | kLanceWFlag);
+        update(none_flags, s, l, pawn, prev_flags, l, kChoiceNone);
+        if (square != kSquareEmpty || effected) {
+          continue;
+        }
+
+        update(kOccupiedFlag, s + 1, l, pawn, prev_flags, l, kChoiceStone);
+        if (kind != kColumnWhite && (prev_flags & kOccupiedFlag) == 0) {
+          // It can be a lance if no rank above has a piece
+          int next_l = std::min(l + ((prev_flags & kClearFlag) != 0), max_lance);
+          update(kOccupiedFlag, s, next_l, pawn + 1, prev_flags, l, kChoicePawnB);
+        }
+        if (kind != kColumnBlack) {
+          // A lance facing downward leaves no rank below for pieces, so it is distinguished from a pawn
+          update(kOccupiedFlag | kPawnWFlag, s, l, pawn + 1, prev_flags, l, kChoicePawnW);
+          if (max_lance > 0) {
+            int next_l = std::min(l + 1, max_lance);
+            update(kOccupiedFlag | kLanceWFlag, s, next_l, pawn + 1, prev_flags, l, kChoicePawnW);
+          }
+        }
+      }
+    }
+  }
+}
+
+/// Fill the entries of `table` whose lower `rank` digits are `state`. `layers[rank]` must be already scanned.
+template <int R>
+void FillColumnTable(ColumnTable<R>& table, ColumnKind kind, int rank, int state, ColumnLayer* layers) {
+  if (rank == R) {
+    // `best_pawn[s][l]` is the most pawn-like pieces with `s` stones, at least `l` of which can be lances
+    int best_pawn[R + 1][kColumnMaxLance + 1];
+    for (int s = 0; s <= R; ++s) {
+      int best = kInfeasible;
+      for (int l = kColumnMaxLance; l >= 0; --l) {
+        for (int flags : kReachableFlags) {
+          best = std::max(best, layers[R].pawn[flags][s][l]);
+        }
+        best_pawn[s][l] = best;
+      }
+    }
+
+    // `best_pawn` is non-increasing in `s`, because a stone can always be removed. A pawn-like piece can be removed
+    // too, keeping `l` pieces which can be lances as long as `p >= l`.
+    auto max_stone = [&](int p, int l) {
+      int stone = kInfeasible;
+      for (int s = 0; s <= R && p >= l && best_pawn[s][l] >= p; ++s) {
+        stone = s;
+      }
+      return static_cast<std::int8_t>(stone);
+    };
+    table.max_pawn[kind][state] = static_cast<std::int8_t>(best_pawn[0][0]);
+    for (int p = 0; p <= R; ++p) {
+      table.max_stone[kind][state][p] = max_stone(p, 0);
+      if (kind == kColumnMixed) {
+        for (int l = 0; l <= kColumnMaxLance; ++l) {
+          table.max_stone_lance[state][l][p] = max_stone(p, l);
+        }
+      }
+    }
+    return;
+  }
+
+  // The scan of common lower ranks is shared among states
+  for (int square = 0; square < kSquareStateNum; ++square) {
+    ScanRank(kind, rank, SquareState(square), layers[rank], layers[rank + 1], nullptr);
+    FillColumnTable(table, kind, rank + 1, state + square * Pow3(rank), layers);
+  }
+}
+
+template <int F, int R>
+void BuildColumnTable() {
+  auto& table = kColumnTable<F, R>;
+  for (int bits = 0; bits < (1 << R); ++bits) {
+    int ternary = 0;
+    for (int rank = R - 1; rank >= 0; --rank) {
+      ternary = 3 * ternary + ((bits >> rank) & 1);
+    }
+    table.ternary[bits] = static_cast<std::uint16_t>(ternary);
+  }
+
+  ColumnLayer layers[R + 1];
+  InitLayer(layers[0]);
+  for (int kind = 0; kind < kColumnKindNum; ++kind) {
+    FillColumnTable(table, ColumnKind(kind), 0, 0, layers);
+  }
+}
+}  // namespace
+
+template <int F, int R>
+void InitColumnTable() {
+  // The initialization of a static local variable is thread-safe, so the table is built exactly once
+  [[maybe_unused]] static const bool kBuilt = (BuildColumnTable<F, R>(), true);
+}
+
+int SolveColumn(ColumnKind kind,
+                int rank_num,
+                u64 empty,
+                u64 occupied,
+                int stone,
+                int lance,
+                ColumnPlacement& placement) {
+  ColumnLayer layers[kColumnMaxRank + 1];
+  ColumnParent parents[kColumnMaxRank];
+  InitLayer(layers[0]);
+  for (int rank = 0; rank < rank_num; ++rank) {
+    SquareState square = ((empty >> rank) & 1)      ? kSquareEmpty
+                         : ((occupied >> rank) & 1) ? kSquareOccupied
+                                                    : kSquareEffected;
+    ScanRank(kind, rank, square, layers[rank], layers[rank + 1], &parents[rank]);
+  }
+
+  if (stone < 0 || stone > rank_num || lance > kColumnMaxLance) {
+    return -1;
+  }
+  int flags = 0;
+  int l = kColumnMaxLance;
+  for (int f : kReachableFlags) {
+    for (int i = std::max(lance, 0); i <= kColumnMaxLance; ++i) {
+      const auto& last = layers[rank_num].pawn;
+      if (last[f][stone][i] > last[flags][stone][l] || (last[f][stone][i] == last[flags][stone][l] && i > l)) {
+        flags = f;
+        l = i;
+      }
+    }
+  }
+  int pawn = layers[rank_num].pawn[flags][stone][l];
+  if (pawn == kInfeasible) {
+    return -1;
+  }
+
+  placement = ColumnPlacement{};
+  int s = stone;
+  for (int rank = rank_num - 1; rank >= 0; --rank) {
+    int choice = parents[rank].choice[flags][s][l];
+    u64 bit = u64{1} << rank;
+    if (choice == kChoiceStone) {
+      placement.stone |= bit;
+    } else if (choice == kChoicePawnB) {
+      placement.pawn_b |= bit;
+    } else if (choice == kChoicePawnW) {
+      placement.pawn_w |= bit;
+    }
+    int prev_flags = parents[rank].flags[flags][s][l];
+    l = parents[rank].lance[flags][s][l];
+    flags = prev_flags;
+    s -= choice == kChoiceStone;
+  }
+  return pawn;
+}
+
+#define KOMORI_INSTANTIATE(F, R) template void InitColumnTable<F, R>();
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+
+namespace {
+/// Build every table before `main`, so that the tables are never written while searching
+[[maybe_unused]] const bool kColumnTablesBuilt = [] {
+#define KOMORI_INIT(F, R) InitColumnTable<F, R>();
+  KOMORI_FOR_EACH_BOARD(KOMORI_INIT)
+#undef KOMORI_INIT
+  return true;
+}();
+}  // namespace
+}  // namespace komori
@@ -0,0 +1,93 @@
+#ifndef KOMORI_COLUMN_TABLE_HPP_
+#define KOMORI_COLUMN_TABLE_HPP_
+
+#include <cstdint>
+
+#include "shogi.hpp"
+
+namespace komori {
+/// The directions which pawn-like pieces face
+enum ColumnKind {
+  kColumnBlack,  ///< Every pawn-like piece faces upward
+  kColumnWhite,  ///< Every pawn-like piece faces downward
+  kColumnMixed,  ///< Each pawn-like piece faces either direction
+  kColumnKindNum,
+};
+
+/// The maximum number of ranks supported by column tables
+constexpr int kColumnMaxRank = 10;
+/**
+ * @brief The maximum number of pawn-like pieces in a file which can be lances
+ *
+ * A pawn-like piece can be a lance if no piece is in front of it in the file, because the lance effects every square
+ * there. Two such pieces facing the same direction would effect each other, so a file holds at most one of each
+ * direction.
+ */
+constexpr int kColumnMaxLance = 2;
+
+/// 3^`n`
+constexpr int Pow3(int n) {
+  return n == 0 ? 1 : 3 * Pow3(n - 1);
+}
+
+/**
+ * @brief The exact capacities of a file for pawn-like pieces and stones
+ *
+ * A pawn-like piece effects the square in front of it, and a stone effects nothing. Both of them are placed on squares
+ * which are empty and not effected. Since such pieces never effect other files, the capacity of a board is the sum of
+ * the capacities of its files.
+ *
+ * The state of a file is a ternary number whose i-th digit is 0 if the i-th rank is effected, 1 if it is empty and not
+ * effected, and 2 if it is occupied. It is `ternary[empty] + 2 * ternary[occupied]` for the bits of a file.
+ */
+template <int R>
+struct ColumnTable {
+  static_assert(R <= kColumnMaxRank, "the board is too large for column tables");
+  static constexpr int kStateNum = Pow3(R);
+
+  /// The ternary number whose digits are the bits of the index
+  std::uint16_t ternary[1 << R];
+  /// The maximum number of pawn-like pieces which can be placed
+  std::int8_t max_pawn[kColumnKindNum][kStateNum];
+  /// The maximum number of stones which can be placed together with `p` pawn-like pieces (-1 if `p` is too many)
+  std::int8_t max_stone[kColumnKindNum][kStateNum][R + 1];
+  /**
+   * @brief The maximum number of stones which can be placed together with `p` pawn-like pieces facing either direction,
+   * at least `l` of which can be lances (-1 if impossible)
+   *
+   * `max_stone_lance[state][0]` is the same as `max_stone[kColumnMixed][state]`.
+   */
+  std::int8_t max_stone_lance[kStateNum][kColumnMaxLance + 1][R + 1];
+};
+
+/// The column table of the board which has `F` files and `R` ranks
+template <int F, int R>
+inline ColumnTable<R> kColumnTable;
+
+/// Build `kColumnTable<F, R>`. It is thread-safe in the same way as `InitAttackBB`.
+template <int F, int R>
+void InitColumnTable();
+
+/// A placement in a file, whose i-th bit is the i-th rank
+struct ColumnPlacement {
+  u64 pawn_b{0};
+  u64 pawn_w{0};
+  u64 stone{0};
+};
+
+/**
+ * @brief Place exactly `stone` stones and as many pawn-like pieces as possible in a file, at least `lance` of which can
+ * be lances (see `kColumnMaxLance`)
+ *
+ * @return The number of pawn-like pieces, or -1 if no such placement exists
+ */
+int SolveColumn(ColumnKind kind,
+                int rank_num,
+                u64 empty,
+                u64 occupied,
+                int stone,
+                int lance,
+                ColumnPlacement& placement);
+}  // namespace komori
+
+#endif  // KOMORI_COLUMN_TABLE_HPP_
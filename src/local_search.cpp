@@ -0,0 +1,184 @@
+#include "local_search.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#include "shogi.hpp"
+
+namespace komori {
+template <int F, int R>
+BasicLocalSearch<F, R>::BasicLocalSearch(const LocalSearchConfiguration& config) : config_{config}, rng_{config.seed} {
+  InitAttackBB<F, R>();
+}
+
+template <int F, int R>
+bool BasicLocalSearch<F, R>::Run(const PCVector& pc_list) {
+  auto start_time = std::chrono::steady_clock::now();
+  ans_sfen_.clear();
+  stop_.store(false);
+  step_count_ = 0;
+
+  pieces_.clear();
+  for (auto pc : pc_list) {
+    pieces_.push_back({pc, 0});
+  }
+  squares_.clear();
+  Bitboard all_bb = allOneBB<F, R>();
+  while (all_bb.isAny()) {
+    squares_.push_back(all_bb.firstOneFromSQ11());
+  }
+  if (pieces_.size() > squares_.size()) {
+    return false;
+  }
+
+  for (;;) {
+    RandomPlacement();
+    for (u64 step = 0; step < config_.restart_steps; ++step) {
+      if (conflict_cnt_ == 0) {
+        if (!Verify()) {
+          throw std::logic_error("local search reached a broken placement");
+        }
+        ans_sfen_ = Pieces2Sfen<F, R>(pieces_);
+        return true;
+      }
+
+      // Check the budget. Reading the clock is slow, so it is checked only occasionally.
+      if (stop_.load(std::memory_order_relaxed) || config_.cancel_token.IsCancelled() ||
+          step_count_ >= config_.step_limit) {
+        return false;
+      }
+      if (step_count_ % 1024 == 0) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        if (elapsed.count() >= config_.time_limit) {
+          return false;
+        }
+      }
+
+      // Every square is occupied, so no piece can move
+      if (pieces_.size() == squares_.size()) {
+        return false;
+      }
+
+      Step();
+      ++step_count_;
+    }
+  }
+}
+
+template <int F, int R>
+void BasicLocalSearch<F, R>::RandomPlacement(void) {
+  pieces_bb_ = allZeroBB<F, R>();
+  std::fill(std::begin(owner_), std::end(owner_), kNoPiece);
+  std::fill(std::begin(attacked_cnt_), std::end(attacked_cnt_), 0);
+  conflict_cnt_ = 0;
+
+  std::shuffle(squares_.begin(), squares_.end(), rng_);
+  for (int i = 0; i < static_cast<int>(pieces_.size()); ++i) {
+    Put(i, squares_[i]);
+  }
+}
+
+template <int F, int R>
+void BasicLocalSearch<F, R>::Put(int i, Square sq) {
+  PieceType pc = pieces_[i].pc;
+  Bitboard attack = AttackBB<F, R>(pc, sq) ^ SquareMaskBB<F, R>(sq);
+
+  pieces_[i].sq = sq;
+  conflict_cnt_ += attacked_cnt_[sq] + (attack & pieces_bb_).popCount();
+  pieces_bb_ |= SquareMaskBB<F, R>(sq);
+  owner_[sq] = i;
+
+  while (attack.isAny()) {
+    ++attacked_cnt_[attack.firstOneFromSQ11()];
+  }
+}
+
+template <int F, int R>
+void BasicLocalSearch<F, R>::Remove(int i) {
+  PieceType pc = pieces_[i].pc;
+  Square sq = pieces_[i].sq;
+  Bitboard attack = AttackBB<F, R>(pc, sq) ^ SquareMaskBB<F, R>(sq);
+
+  pieces_bb_.clearBit(sq);
+  owner_[sq] = kNoPiece;
+  conflict_cnt_ -= attacked_cnt_[sq] + (attack & pieces_bb_).popCount();
+
+  while (attack.isAny()) {
+    --attacked_cnt_[attack.firstOneFromSQ11()];
+  }
+}
+
+template <int F, int R>
+void BasicLocalSearch<F, R>::Step(void) {
+  // Choose a piece in conflict at random (reservoir sampling)
+  int chosen = kNoPiece;
+  u64 seen = 0;
+  for (int i = 0; i < static_cast<int>(pieces_.size()); ++i) {
+    const auto& piece = pieces_[i];
+    Bitboard attack = AttackBB<F, R>(piece.pc, piece.sq) ^ SquareMaskBB<F, R>(piece.sq);
+    if (attacked_cnt_[piece.sq] > 0 || attack.andIsAny(pieces_bb_)) {
+      if (rng_() % ++seen == 0) {
+        chosen = i;
+      }
+    }
+  }
+
+  PieceType pc = pieces_[chosen].pc;
+  Square from = pieces_[chosen].sq;
+  Remove(chosen);
+
+  Square to = from;
+  if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < config_.noise) {
+    // Random walk to escape from local minima
+    do {
+      to = squares_[rng_() % squares_.size()];
+    } while (to == from || owner_[to] != kNoPiece);
+  } else {
+    int best_cost = std::numeric_limits<int>::max();
+    u64 ties = 0;
+    for (Square sq : squares_) {
+      if (sq == from || owner_[sq] != kNoPiece) {
+        continue;
+      }
+
+      Bitboard attack = AttackBB<F, R>(pc, sq) ^ SquareMaskBB<F, R>(sq);
+      int cost = attacked_cnt_[sq] + (attack & pieces_bb_).popCount();
+      if (cost < best_cost) {
+        best_cost = cost;
+        to = sq;
+        ties = 1;
+      } else if (cost == best_cost && rng_() % ++ties == 0) {
+        to = sq;
+      }
+    }
+  }
+
+  Put(chosen, to);
+}
+
+template <int F, int R>
+bool BasicLocalSearch<F, R>::Verify(void) const {
+  Bitboard pieces_bb = allZeroBB<F, R>();
+  for (const auto& piece : pieces_) {
+    if (!allOneBB<F, R>().isSet(piece.sq) || pieces_bb.isSet(piece.sq)) {
+      return false;
+    }
+    pieces_bb.setBit(piece.sq);
+  }
+
+  for (const auto& piece : pieces_) {
+    Bitboard attack = AttackBB<F, R>(piece.pc, piece.sq) ^ SquareMaskBB<F, R>(piece.sq);
+    if (attack.andIsAny(pieces_bb)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// explicit instanciation
+#define KOMORI_INSTANTIATE(F, R) template class BasicLocalSearch<F, R>;
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
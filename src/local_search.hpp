@@ -0,0 +1,93 @@
+#ifndef KOMORI_LOCAL_SEARCH_HPP_
+#define KOMORI_LOCAL_SEARCH_HPP_
+
+#include <atomic>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+struct LocalSearchConfiguration {
+  /// The upper limit of the number of moves
+  u64 step_limit{std::numeric_limits<u64>::max()};
+  /// The upper limit of searching time in seconds
+  double time_limit{std::numeric_limits<double>::infinity()};
+  /// The number of moves before a random restart
+  u64 restart_steps{20000};
+  /// The probability of a random move instead of the best one
+  double noise{0.1};
+  u64 seed{0};
+  /// The search stops when this token is cancelled. Unlike `BasicLocalSearch::Stop()`, it also stops later runs.
+  CancellationToken cancel_token{};
+};
+
+/**
+ * @brief A min-conflicts local search engine for the board which has `F` files and `R` ranks
+ *
+ * It keeps every piece on the board and moves a piece in conflict to the square with the fewest conflicts, until no
+ * piece attacks any other piece. It often finds a placement much faster than `BasicSearch`, but it cannot prove that
+ * no placement exists.
+ */
+template <int F, int R>
+class BasicLocalSearch {
+ public:
+  using Bitboard = BasicBitboard<F, R>;
+
+  BasicLocalSearch(const LocalSearchConfiguration& config);
+  BasicLocalSearch(const BasicLocalSearch&) = delete;
+  BasicLocalSearch(BasicLocalSearch&&) = delete;
+  BasicLocalSearch& operator=(const BasicLocalSearch&) = delete;
+  BasicLocalSearch& operator=(BasicLocalSearch&&) = delete;
+  ~BasicLocalSearch(void) = default;
+
+  /**
+   * @brief Search a placement of `pc_list`. It returns false if the budget is exhausted or it is stopped.
+   *
+   * Each run has its own budget, and `Stop()` called before the run has no effect.
+   */
+  bool Run(const PCVector& pc_list);
+  /// Stop the running search (thread-safe)
+  void Stop(void) { stop_.store(true); }
+  const std::string& AnsSfen(void) const { return ans_sfen_; }
+  u64 StepCount(void) const { return step_count_; }
+
+ private:
+  static constexpr int kSquareNum = Board<F, R>::kSquareNum;
+  /// A mark of an empty square in `owner_`
+  static constexpr int kNoPiece = -1;
+
+  /// Place pieces on random squares
+  void RandomPlacement(void);
+  void Put(int i, Square sq);
+  void Remove(int i);
+  /// Move a piece in conflict to the square with the fewest conflicts
+  void Step(void);
+  /// Judge if the current placement is a solution without using the counters
+  bool Verify(void) const;
+
+  LocalSearchConfiguration config_;
+  std::mt19937_64 rng_;
+  std::atomic<bool> stop_{false};
+  u64 step_count_{0};
+  std::string ans_sfen_{};
+
+  PiecePositions pieces_{};
+  std::vector<Square> squares_{};
+  Bitboard pieces_bb_{};
+  /// The index in `pieces_` of the piece on each square
+  int owner_[kSquareNum];
+  /// The number of pieces attacking each square
+  int attacked_cnt_[kSquareNum];
+  /// The number of (attacking piece, attacked piece) pairs
+  int conflict_cnt_{0};
+};
+
+/// The local search engine for the standard 9x9 board
+using LocalSearch = BasicLocalSearch<9, 9>;
+}  // namespace komori
+
+#endif  // KOMORI_LOCAL_SEARCH_HPP_
@@ -1,12 +1,28 @@
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "local_search.hpp"
+#include "parallel_search.hpp"
+#include "screen.hpp"
 #include "search.hpp"
 #include "shogi.hpp"
+#include "sweep.hpp"
+#include "tuner.hpp"
+#include "verifier.hpp"
 
 using namespace komori;
 
@@ -15,26 +31,851 @@ void help_and_exit(int argc, char* argv[]) {
   std::printf("usage: %s [-a] [-n node_limit] [-v] --\n", argv[0]);
   std::printf("-a            : find all solutions (may take very long time");
   std::printf("-b            : consider piece reverse\n");
-  std::printf("-n node_limit : node limits of searching\n");
+  std::printf("-n node_limit : node limits of searching (step limits with --local)\n");
+  std::printf("--board FxR   : search on the board with F files and R ranks (default: 9x9)\n");
+  std::printf("--maximize pc : find the maximum number of pc which can be placed with sfen\n");
+  std::printf("--split depth : print subproblems which have depth pieces placed\n");
+  std::printf("--solve-subproblem file : solve subproblems written by --split\n");
+  std::printf("--merge file... : merge the results of --solve-subproblem\n");
+  std::printf("--local       : search a placement by min-conflicts local search\n");
+  std::printf("--race        : run the exhaustive search and the local search at the same time\n");
+  std::printf("--time-limit sec : time limits of searching\n");
+  std::printf("--seed n      : random seed of the local search and --tune\n");
+  std::printf("--portfolio n : run n differently ordered searches at the same time\n");
+  std::printf("--order-seed n : shuffle the order of pieces by the seed n\n");
+  std::printf("--reverse-scan : try squares from 9i to 1a\n");
+  std::printf("--score-order : try squares which effect the fewest empty squares first\n");
+  std::printf("--group-runs  : place each run of identical pieces at once\n");
+  std::printf("--order-table file : sort pieces by the table in file\n");
+  std::printf("--tune corpus : tune the order table for the piece sets in corpus\n");
+  std::printf("--tune-iterations n : the number of tables tried by --tune (default: 200)\n");
+  std::printf("--perf        : print hardware counters of the search if available\n");
+  std::printf("--estimate    : estimate the time to find all placements in a few seconds\n");
+  std::printf("--verify file : check that every sfen in file is a placement of sfen\n");
+  std::printf("--threads n   : find all solutions of -a with n threads (0: the number of CPUs), or check with n threads\n");
+  std::printf("--unordered   : print the solutions of -a --threads as soon as found\n");
+  std::printf("--capture-judge file : write inputs of the judges of pawns and stones to file for the benchmark\n");
+  std::printf("--no-screen   : search without checking the capacities of pieces first\n");
+  std::printf("--stats       : find all solutions and print their aggregates in JSON instead of them\n");
+  std::printf("--batch file  : find a placement of each piece set in file in one search over their common prefixes\n");
+  std::printf("--sweep P0-9,S0-4,... : find the frontier of placeable sets of sfen plus the pieces in the ranges\n");
+  std::printf("--capacity-table : compute the capacity table of the board in --time-limit sec per search (default: 10)\n");
   std::printf("--            : read from stdin\n");
   std::exit(EXIT_FAILURE);
 }
 
-int main(int argc, char* argv[]) {
+namespace {
+/// Settings passed from the command line
+struct Options {
   komori::SearchConfiguration config{};
+  PCVector pc_list{};
+  /// The piece to maximize (`PieceEmpty` if not specified)
+  PieceType maximize_pc{PieceEmpty};
+  /// The depth to split the search into subproblems (-1 if not specified)
+  int split_depth{-1};
+  /// Subproblems to solve (empty if not specified)
+  std::vector<std::string> subproblems{};
+  komori::LocalSearchConfiguration local_config{};
+  /// Use only the local search
+  bool local{false};
+  /// Run the exhaustive search and the local search in parallel
+  bool race{false};
+  /// The number of searches in the portfolio (0 if not specified)
+  int portfolio{0};
+  /// The piece sets to tune the order table for (empty if not specified)
+  std::vector<PCVector> tune_corpus{};
+  komori::TuneConfiguration tune_config{};
+  /// Estimate the size of the search instead of searching
+  bool estimate{false};
+  /// The output of the search to verify (empty if not specified)
+  std::string verify_file{};
+  komori::VerifyConfiguration verify_config{};
+  /// Find all placements with threads (`-a` with `--threads`)
+  bool parallel{false};
+  komori::ParallelConfiguration parallel_config{};
+  /// Reject piece sets which exceed the capacities of the board before searching
+  bool screen{true};
+  /// Compute the capacity table instead of searching
+  bool capacity_table{false};
+  /// The piece sets to solve in a batch (empty if not specified)
+  std::vector<PCVector> batch{};
+  /// The lines of `batch` as written in the file
+  std::vector<std::string> batch_lines{};
+  /// The ranges of pieces to sweep (empty if not specified)
+  komori::SweepConfiguration sweep_config{};
+};
+
+/**
+ * @brief Get the pieces in `pc_list` which are not in `pieces`.
+ *
+ * In reversible search, the directions of pieces and the kinds of golds are ignored because the search simplifies them.
+ */
+PCVector UnplacedPieces(const PCVector& pc_list, const PiecePositions& pieces, bool reverse_search) {
+  PCVector unplaced;
+  std::vector<bool> used(pieces.size(), false);
+  for (auto pc : pc_list) {
+    auto itr = std::find_if(pieces.begin(), pieces.end(), [&](const PiecePosition& piece) {
+      return !used[&piece - pieces.data()] &&
+             PieceSetKey(piece.pc, reverse_search) == PieceSetKey(pc, reverse_search);
+    });
+    if (itr != pieces.end()) {
+      used[itr - pieces.begin()] = true;
+    } else {
+      unplaced.push_back(pc);
+    }
+  }
+  return unplaced;
+}
+
+/// Get a string of `pc_list` in the same format as the input (e.g. "P3N")
+std::string Pcvector2String(PCVector pc_list) {
+  std::sort(pc_list.begin(), pc_list.end());
+  std::string str;
+  for (auto itr = pc_list.begin(); itr != pc_list.end();) {
+    auto next = std::find_if(itr, pc_list.end(), [&](PieceType pc) { return pc != *itr; });
+    str += UsiString(*itr);
+    if (next - itr > 1) {
+      str += std::to_string(next - itr);
+    }
+    itr = next;
+  }
+  return str;
+}
+
+/// The line which ends the result of `--solve-subproblem` if every subproblem is solved
+constexpr char kSolvedTag[] = "solved";
+/// The line which ends the result of `--solve-subproblem` if `-n` or `--time-limit` stopped it
+constexpr char kBudgetExhaustedTag[] = "budget-exhausted";
+
+/**
+ * @brief Merge the results of `--solve-subproblem` and print them as if it were a single search
+ *
+ * If a result was stopped by the budget, the number of placements is a lower bound, and the output ends with `status
+ * budget-exhausted` unless a placement is found without `-a`.
+ */
+int MergeMain(const std::vector<std::string>& result_files, bool all_placement) {
+  std::vector<std::string> sfens;
+  u64 found_cnt = 0;
+  bool exhausted = false;
+  for (const auto& result_file : result_files) {
+    std::ifstream ifs(result_file);
+    if (!ifs) {
+      std::printf("cannot open %s\n", result_file.c_str());
+      return EXIT_FAILURE;
+    }
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.compare(0, sizeof(kSolvedTag) - 1, kSolvedTag) == 0) {
+        found_cnt += std::stoull(line.substr(sizeof(kSolvedTag)));
+      } else if (line.compare(0, sizeof(kBudgetExhaustedTag) - 1, kBudgetExhaustedTag) == 0) {
+        found_cnt += std::stoull(line.substr(sizeof(kBudgetExhaustedTag)));
+        exhausted = true;
+      } else if (!line.empty()) {
+        sfens.push_back(line);
+      }
+    }
+  }
+
+  if (found_cnt > 0) {
+    for (const auto& sfen : sfens) {
+      std::cout << sfen << std::endl;
+      if (!all_placement) {
+        break;
+      }
+    }
+
+    if (all_placement) {
+      std::cout << (exhausted ? "found >= " : "found ") << found_cnt << " solutions" << std::endl;
+    }
+  } else if (!exhausted) {
+    std::cout << "not found" << std::endl;
+  }
+
+  if (exhausted && (all_placement || found_cnt == 0)) {
+    std::cout << "status budget-exhausted" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+/// Tune the order table for `options.tune_corpus` and print it in the format of `--order-table`
+template <int F, int R>
+int TuneMain(const Options& options) {
+  TuneConfiguration tune_config = options.tune_config;
+  if (options.config.node_limit != BasicSearch<F, R>::Unlimit) {
+    tune_config.node_limit = options.config.node_limit;
+  }
+  tune_config.on_improve = [](int iteration, u64 cost) {
+    std::cerr << "iteration " << iteration << " nodes " << cost << std::endl;
+  };
+
+  auto result = TuneOrderTable<F, R>(options.config, options.tune_corpus, tune_config);
+  std::cout << "# nodes " << result.initial_cost << " -> " << result.cost << std::endl;
+  std::cout << OrderTable2String(result.table);
+  return EXIT_SUCCESS;
+}
+
+/// The time of `--estimate` without `--time-limit`
+constexpr double kDefaultEstimateSeconds = 3.0;
+
+/**
+ * @brief Estimate the number of nodes and the time to find all placements
+ *
+ * The search itself runs for a quarter of the time in order to measure its speed, and the rest of the time is used for
+ * Knuth's estimator. If the search completes in the time, the exact counts are printed instead.
+ */
+template <int F, int R>
+int EstimateMain(const Options& options) {
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](double sec) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(sec)); };
+  double budget = std::isfinite(options.local_config.time_limit) ? options.local_config.time_limit
+                                                                  : kDefaultEstimateSeconds;
+
+  SearchConfiguration config = options.config;
+  config.all_placement = true;
+  config.on_solution = [](const std::string&) { return true; };
+  config.deadline = Clock::now() + seconds(budget / 4);
+  BasicSearch<F, R> search(config);
+  auto start = Clock::now();
+  int found_cnt = search.Run(options.pc_list);
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  if (!search.NodeLimitReached()) {
+    std::cout << "nodes " << search.NodeCount() << " (exact)" << std::endl;
+    std::cout << "solutions " << found_cnt << " (exact)" << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  config.deadline = Clock::now() + seconds(budget * 3 / 4);
+  BasicSearch<F, R> estimator(config);
+  auto result = estimator.Estimate(options.pc_list, options.local_config.seed);
+  double nodes_per_sec = search.NodeCount() / std::max(elapsed, 1e-9);
+  std::printf("probes %" PRIu64 "\n", result.probe_cnt);
+  std::printf("nodes %.3e +- %.1e\n", result.nodes, result.nodes_error);
+  std::printf("solutions %.3e +- %.1e\n", result.solutions, result.solutions_error);
+  std::printf("nodes/sec %.3e\n", nodes_per_sec);
+  std::printf("time %.3e +- %.1e sec\n", result.nodes / nodes_per_sec, result.nodes_error / nodes_per_sec);
+  return EXIT_SUCCESS;
+}
+
+/// Verify the placements in `options.verify_file` and print the first wrong one
+template <int F, int R>
+int VerifyMain(const Options& options) {
+  std::ifstream ifs(options.verify_file);
+  if (!ifs) {
+    std::printf("cannot open %s\n", options.verify_file.c_str());
+    return EXIT_FAILURE;
+  }
+  std::ostringstream ss;
+  ss << ifs.rdbuf();
+
+  VerifyConfiguration verify_config = options.verify_config;
+  verify_config.reverse_search = options.config.reverse_search;
+  auto result = VerifySfens<F, R>(ss.str(), options.pc_list, verify_config);
+  if (result.ng_cnt > 0) {
+    std::cout << "ng line " << result.first_ng_line << ": " << result.first_ng_reason << std::endl;
+  }
+  std::cout << "ok " << result.ok_cnt << " ng " << result.ng_cnt << " skipped " << result.skip_cnt << std::endl;
+  return result.ng_cnt > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the hardware counters of `search` per phase
+ *
+ * The counters of a phase are the averages of the measured runs of it. Nothing is printed if no counter is available.
+ */
+template <int F, int R>
+void PrintProfile(const BasicSearch<F, R>& search) {
+  const auto& profile = search.Profile();
+  if (!profile.IsAnyAvailable()) {
+    return;
+  }
+
+  std::cout << "perf nodes " << search.NodeCount() << std::endl;
+  for (int phase = 0; phase < kPerfPhaseNum; ++phase) {
+    u64 sampled = profile.sampled[phase];
+    std::printf("perf %s calls %" PRIu64 " sampled %" PRIu64, PerfPhaseName(PerfPhase(phase)), profile.calls[phase],
+                sampled);
+    for (int event = 0; event < kPerfEventNum && sampled > 0; ++event) {
+      if (profile.available[event]) {
+        std::printf(" %s %.4g", PerfEventName(PerfEvent(event)),
+                    static_cast<double>(profile.values[phase].value[event]) / sampled);
+      }
+    }
+    std::printf("\n");
+  }
+  std::fflush(stdout);
+}
+
+/**
+ * @brief Find all placements with `options.parallel_config` and print them in the same format as the search without
+ * threads
+ *
+ * The placements are printed as soon as they are reported. If the search is interrupted before it finds any placement,
+ * "not found" is printed instead of the deepest placement.
+ */
+template <int F, int R>
+int ParallelMain(const Options& options) {
+  bool limited = options.config.node_limit != BasicSearch<F, R>::Unlimit ||
+                 options.config.deadline != std::chrono::steady_clock::time_point::max();
+  SearchConfiguration config = options.config;
+  config.on_solution = [](const std::string& sfen) {
+    std::cout << sfen << '\n';
+    return true;
+  };
+  auto result = SearchAllParallel<F, R>(config, options.pc_list, options.parallel_config);
+  if (options.config.stats) {
+    std::cout << SolutionStats2Json(result.stats) << std::endl;
+  }
+  if (result.found_cnt > 0) {
+    std::cout << "found " << result.found_cnt << " solutions" << std::endl;
+  } else {
+    std::cout << "not found" << std::endl;
+  }
+
+  if (limited) {
+    const char* status = result.interrupted ? "budget-exhausted" : (result.found_cnt > 0 ? "solved" : "unsolvable");
+    std::cout << "status " << status << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Search a placement only by the local search
+ *
+ * The local search cannot prove that no placement exists, so "status budget-exhausted" is printed instead of "not
+ * found" if it fails.
+ */
+template <int F, int R>
+int LocalMain(const Options& options) {
+  BasicLocalSearch<F, R> local_search(options.local_config);
+  if (local_search.Run(options.pc_list)) {
+    std::cout << local_search.AnsSfen() << std::endl;
+  } else {
+    std::cout << "status budget-exhausted" << std::endl;
+  }
+  std::cout << "steps " << local_search.StepCount() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run the exhaustive search and the local search in parallel and print the result of the first one.
+ *
+ * The exhaustive search wins if it finds a placement or proves that no placement exists. The local search wins only if
+ * it finds a placement. The loser is stopped as soon as the winner is decided. With `-b`, only the exhaustive search
+ * runs, because the local search does not support reversible search.
+ */
+template <int F, int R>
+int RaceMain(const Options& options) {
+  enum Winner { kNone, kDfs, kLocal };
+
+  SearchConfiguration config = options.config;
+  config.all_placement = false;
+  BasicSearch<F, R> search(config);
+  // The local search is stopped by the token, which is not reset even if it has not started yet
+  LocalSearchConfiguration local_config = options.local_config;
+  local_config.cancel_token = CancellationToken{};
+  BasicLocalSearch<F, R> local_search(local_config);
+  std::atomic<int> winner{kNone};
+
+  int found_cnt = 0;
+  std::thread dfs_thread([&] {
+    found_cnt = search.Run(options.pc_list);
+    int expected = kNone;
+    if ((found_cnt > 0 || !search.NodeLimitReached()) && winner.compare_exchange_strong(expected, kDfs)) {
+      local_config.cancel_token.Cancel();
+    }
+  });
+
+  if (!options.config.reverse_search && local_search.Run(options.pc_list)) {
+    int expected = kNone;
+    if (winner.compare_exchange_strong(expected, kLocal)) {
+      search.Stop();
+    }
+  }
+  dfs_thread.join();
+
+  if (winner == kDfs && found_cnt > 0) {
+    std::cout << search.AnsSfens()[0] << std::endl;
+  } else if (winner == kLocal) {
+    std::cout << local_search.AnsSfen() << std::endl;
+  } else {
+    std::cout << "not found" << std::endl;
+  }
+
+  if (winner != kNone) {
+    std::cout << "winner " << (winner == kDfs ? "dfs" : "local") << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run `options.portfolio` searches with different piece orders and square orders in parallel.
+ *
+ * The i-th search scans squares in reverse if i is odd, and shuffles the piece order by the seed i / 2. The first
+ * search that finds a placement or proves that no placement exists stops the others.
+ */
+template <int F, int R>
+int PortfolioMain(const Options& options) {
+  constexpr int kNoWinner = -1;
+
+  std::vector<std::unique_ptr<BasicSearch<F, R>>> searches;
+  for (int i = 0; i < options.portfolio; ++i) {
+    SearchConfiguration config = options.config;
+    config.all_placement = false;
+    config.reverse_scan = i % 2 == 1;
+    config.order_seed = i / 2;
+    searches.push_back(std::make_unique<BasicSearch<F, R>>(config));
+  }
+
+  std::atomic<int> winner{kNoWinner};
+  std::vector<int> found_cnts(options.portfolio, 0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.portfolio; ++i) {
+    threads.emplace_back([&, i] {
+      auto& search = *searches[i];
+      found_cnts[i] = search.Run(options.pc_list);
+      int expected = kNoWinner;
+      if ((found_cnts[i] > 0 || !search.NodeLimitReached()) && winner.compare_exchange_strong(expected, i)) {
+        for (auto& other : searches) {
+          other->Stop();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  int i = winner;
+  if (i != kNoWinner && found_cnts[i] > 0) {
+    std::cout << searches[i]->AnsSfens()[0] << std::endl;
+  } else {
+    std::cout << "not found" << std::endl;
+  }
+
+  if (i != kNoWinner) {
+    const auto& config = searches[i]->Config();
+    std::cout << "winner " << i << " --order-seed " << config.order_seed << (config.reverse_scan ? " --reverse-scan" : "")
+              << " nodes " << searches[i]->NodeCount() << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+/// The time of each search of `--capacity-table` without `--time-limit`
+constexpr double kDefaultCapacitySeconds = 10.0;
+
+/// Compute the capacity table of the board and print it in the format of `capacity_table.cpp`
+template <int F, int R>
+int CapacityTableMain(const Options& options) {
+  double seconds = std::isfinite(options.local_config.time_limit) ? options.local_config.time_limit
+                                                                   : kDefaultCapacitySeconds;
+  auto table = GenerateCapacityTable<F, R>(seconds, [](PieceType pt, bool mixed, const CapacityProof& proof) {
+    std::cerr << UsiString(pt) << (mixed ? " mixed" : " single") << " placed " << proof.placed << " unplaceable "
+              << proof.unplaceable << std::endl;
+  });
+  std::cout << CapacityTable2String(table);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Find a placement of each piece set of `options.batch` by `BasicSearch::RunBatch` and print the verdicts
+ *
+ * Each line is the piece set as written in the file followed by its status and, if solved, the placement. Piece sets
+ * rejected by the screen are not searched.
+ */
+template <int F, int R>
+int BatchMain(const Options& options) {
+  std::vector<BatchVerdict> verdicts(options.batch.size());
+  std::vector<std::string> reasons(options.batch.size());
+  std::vector<PCVector> pc_lists;
+  std::vector<std::size_t> searched;
+  for (std::size_t i = 0; i < options.batch.size(); ++i) {
+    auto screen = options.screen ? ScreenPieces<F, R>(options.batch[i], false) : ScreenResult{};
+    if (screen.infeasible) {
+      verdicts[i].status = kBatchUnsolvable;
+      reasons[i] = std::move(screen.reason);
+    } else {
+      pc_lists.push_back(options.batch[i]);
+      searched.push_back(i);
+    }
+  }
+
+  BasicSearch<F, R> search(options.config);
+  auto found = search.RunBatch(pc_lists);
+  for (std::size_t j = 0; j < searched.size(); ++j) {
+    verdicts[searched[j]] = std::move(found[j]);
+  }
+
+  for (std::size_t i = 0; i < verdicts.size(); ++i) {
+    std::cout << options.batch_lines[i] << " ";
+    switch (verdicts[i].status) {
+      case kBatchSolved:
+        std::cout << "solved " << verdicts[i].sfen;
+        break;
+      case kBatchUnsolvable:
+        std::cout << "unsolvable" << (reasons[i].empty() ? "" : " screened " + reasons[i]);
+        break;
+      default:
+        std::cout << "budget-exhausted";
+        break;
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "nodes " << search.NodeCount() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the frontier of placeable sets found by `SweepFrontier`
+ *
+ * The maximal placeable sets are printed with their placements, followed by the minimal unplaceable sets and the sets
+ * left unknown by the limits. Each query is printed to stderr as it is decided.
+ */
+template <int F, int R>
+int SweepMain(const Options& options) {
+  auto set_of = [&](const std::vector<int>& counts) {
+    PCVector pc_list = options.pc_list;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      pc_list.insert(pc_list.end(), counts[i], options.sweep_config.ranges[i].pc);
+    }
+    return Pcvector2String(pc_list);
+  };
+
+  SweepConfiguration sweep_config = options.sweep_config;
+  sweep_config.screen = options.screen;
+  sweep_config.on_query = [&](const std::vector<int>& counts, int status) {
+    std::cerr << "query " << set_of(counts) << " "
+              << (status > 0 ? "placeable" : (status == 0 ? "unplaceable" : "unknown")) << std::endl;
+  };
+  auto result = SweepFrontier<F, R>(options.config, options.pc_list, sweep_config);
+
+  for (const auto& point : result.maximal_feasible) {
+    std::cout << "maximal " << set_of(point.counts) << " " << point.sfen << std::endl;
+  }
+  for (const auto& point : result.minimal_infeasible) {
+    std::cout << "minimal " << set_of(point.counts) << std::endl;
+  }
+  for (const auto& point : result.unknown) {
+    std::cout << "unknown " << set_of(point.counts) << std::endl;
+  }
+  std::cout << "grid " << result.grid_cnt << " queries " << result.query_cnt << " screened " << result.screened_cnt
+            << " warm " << result.warm_start_cnt << " searches " << result.search_cnt << " nodes " << result.node_count
+            << std::endl;
+  return EXIT_SUCCESS;
+}
+
+template <int F, int R>
+int SearchMain(const Options& options) {
+  if (options.capacity_table) {
+    return CapacityTableMain<F, R>(options);
+  }
+  if (!options.tune_corpus.empty()) {
+    return TuneMain<F, R>(options);
+  }
+  if (!options.batch.empty()) {
+    return BatchMain<F, R>(options);
+  }
+  if (!options.sweep_config.ranges.empty()) {
+    return SweepMain<F, R>(options);
+  }
+  if (!options.verify_file.empty()) {
+    return VerifyMain<F, R>(options);
+  }
+  if (options.estimate) {
+    return EstimateMain<F, R>(options);
+  }
+
+  // With a budget, the search is an anytime search which reports its status explicitly
+  bool limited = options.config.node_limit != BasicSearch<F, R>::Unlimit ||
+                 options.config.deadline != std::chrono::steady_clock::time_point::max();
+  // The screen never rejects feasible piece sets, so what it rejects is unsolvable in every mode below
+  if (options.screen && options.split_depth < 0 && options.subproblems.empty()) {
+    auto screen = ScreenPieces<F, R>(options.pc_list, options.config.reverse_search);
+    if (screen.infeasible) {
+      if (options.config.stats) {
+        std::cout << SolutionStats2Json(SolutionStats(F, R)) << std::endl;
+      }
+      std::cout << "not found" << std::endl;
+      std::cout << "screened " << screen.reason << std::endl;
+      if (limited) {
+        std::cout << "status unsolvable" << std::endl;
+      }
+      return EXIT_SUCCESS;
+    }
+  }
+  if (options.portfolio > 0) {
+    return PortfolioMain<F, R>(options);
+  }
+  if (options.local) {
+    return LocalMain<F, R>(options);
+  }
+  if (options.race) {
+    return RaceMain<F, R>(options);
+  }
+
+  BasicSearch<F, R> search(options.config);
+
+  if (options.split_depth >= 0) {
+    for (const auto& subproblem : search.Split(options.pc_list, options.split_depth)) {
+      std::cout << Subproblem2String(subproblem) << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (!options.subproblems.empty()) {
+    u64 found_cnt = 0;
+    for (const auto& line : options.subproblems) {
+      found_cnt += search.Solve(String2Subproblem<F, R>(line));
+      if (!options.config.all_placement && found_cnt > 0) {
+        break;
+      }
+    }
+
+    for (const auto& sfen : search.AnsSfens()) {
+      std::cout << sfen << std::endl;
+    }
+    // The budget is shared by the subproblems, so the rest are not searched once it is exhausted
+    std::cout << (search.NodeLimitReached() ? kBudgetExhaustedTag : kSolvedTag) << " " << found_cnt << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (options.maximize_pc != PieceEmpty) {
+    int max_cnt = search.Maximize(options.pc_list, options.maximize_pc);
+    if (max_cnt >= 0) {
+      std::cout << search.AnsSfens()[0] << std::endl;
+      std::cout << (search.NodeLimitReached() ? "max >= " : "max ") << max_cnt << " " << UsiString(options.maximize_pc)
+                << std::endl;
+    } else if (search.NodeLimitReached()) {
+      // The budget ran out before even the base pieces were placed, which does not prove that they cannot be
+      std::cout << "status budget-exhausted" << std::endl;
+    } else {
+      std::cout << "not found" << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (options.parallel && options.config.all_placement && !options.config.reverse_search) {
+    return ParallelMain<F, R>(options);
+  }
+
+  int found_cnt = search.Run(options.pc_list);
+  if (options.config.stats) {
+    std::cout << SolutionStats2Json(search.Stats()) << std::endl;
+  }
+  if (found_cnt > 0) {
+    for (const auto& sfen : search.AnsSfens()) {
+      std::cout << sfen << std::endl;
+    }
+
+    if (options.config.all_placement) {
+      std::cout << "found " << found_cnt << " solutions" << std::endl;
+    }
+  } else if (limited && search.NodeLimitReached()) {
+    const auto& deepest = search.DeepestPlacement();
+    std::cout << Pieces2Sfen<F, R>(deepest) << std::endl;
+    std::cout << "unplaced "
+              << Pcvector2String(UnplacedPieces(options.pc_list, deepest, options.config.reverse_search)) << std::endl;
+  } else {
+    std::cout << "not found" << std::endl;
+  }
+
+  if (limited) {
+    const char* status = search.NodeLimitReached() ? "budget-exhausted" : (found_cnt > 0 ? "solved" : "unsolvable");
+    std::cout << "status " << status << std::endl;
+  }
+  PrintProfile(search);
+
+  return EXIT_SUCCESS;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options{};
   std::string piece_set;
+  std::string maximize_piece;
+  std::vector<std::string> merge_files;
+  std::ofstream capture_ofs;
+  std::mutex capture_mutex;
+  int file_num = 9;
+  int rank_num = 9;
 
   for (int i = 1; i < argc; ++i) {
     const auto& arg = argv[i];
     if (std::strcmp(arg, "-a") == 0) {
-      config.all_placement = true;
+      options.config.all_placement = true;
     } else if (std::strcmp(arg, "-b") == 0) {
-      config.reverse_search = true;
+      options.config.reverse_search = true;
     } else if (std::strcmp(arg, "-n") == 0) {
       ++i;
       if (i < argc) {
-        config.node_limit = std::stoi(std::string{argv[i]});
+        options.config.node_limit = std::stoi(std::string{argv[i]});
+        options.local_config.step_limit = options.config.node_limit;
       }
+    } else if (std::strcmp(arg, "--board") == 0) {
+      ++i;
+      if (i >= argc || std::sscanf(argv[i], "%dx%d", &file_num, &rank_num) != 2) {
+        help_and_exit(argc, argv);
+      }
+    } else if (std::strcmp(arg, "--maximize") == 0) {
+      ++i;
+      if (i < argc) {
+        maximize_piece = argv[i];
+      }
+    } else if (std::strcmp(arg, "--split") == 0) {
+      ++i;
+      if (i < argc) {
+        options.split_depth = std::stoi(std::string{argv[i]});
+      }
+    } else if (std::strcmp(arg, "--solve-subproblem") == 0) {
+      ++i;
+      std::ifstream ifs(i < argc ? argv[i] : "");
+      std::string line;
+      while (std::getline(ifs, line)) {
+        if (!line.empty()) {
+          options.subproblems.push_back(line);
+        }
+      }
+      if (options.subproblems.empty()) {
+        help_and_exit(argc, argv);
+      }
+      // The board size is written in the subproblem
+      std::istringstream ss(options.subproblems[0]);
+      std::string tag;
+      ss >> tag >> file_num;
+      ss.ignore(1) >> rank_num;
+    } else if (std::strcmp(arg, "--merge") == 0) {
+      merge_files.assign(argv + i + 1, argv + argc);
+      break;
+    } else if (std::strcmp(arg, "--local") == 0) {
+      options.local = true;
+    } else if (std::strcmp(arg, "--race") == 0) {
+      options.race = true;
+    } else if (std::strcmp(arg, "--time-limit") == 0) {
+      ++i;
+      if (i < argc) {
+        options.local_config.time_limit = std::stod(std::string{argv[i]});
+      }
+    } else if (std::strcmp(arg, "--seed") == 0) {
+      ++i;
+      if (i < argc) {
+        options.local_config.seed = std::stoull(std::string{argv[i]});
+        options.tune_config.seed = options.local_config.seed;
+      }
+    } else if (std::strcmp(arg, "--portfolio") == 0) {
+      ++i;
+      if (i < argc) {
+        options.portfolio = std::stoi(std::string{argv[i]});
+      }
+    } else if (std::strcmp(arg, "--order-seed") == 0) {
+      ++i;
+      if (i < argc) {
+        options.config.order_seed = std::stoull(std::string{argv[i]});
+      }
+    } else if (std::strcmp(arg, "--reverse-scan") == 0) {
+      options.config.reverse_scan = true;
+    } else if (std::strcmp(arg, "--score-order") == 0) {
+      options.config.score_order = true;
+    } else if (std::strcmp(arg, "--group-runs") == 0) {
+      options.config.group_runs = true;
+    } else if (std::strcmp(arg, "--order-table") == 0) {
+      ++i;
+      try {
+        options.config.order_table = LoadOrderTable(i < argc ? argv[i] : "");
+      } catch (const std::runtime_error& e) {
+        std::printf("%s\n", e.what());
+        return EXIT_FAILURE;
+      }
+    } else if (std::strcmp(arg, "--tune") == 0) {
+      ++i;
+      std::ifstream ifs(i < argc ? argv[i] : "");
+      std::string line;
+      while (std::getline(ifs, line)) {
+        if (!line.empty() && line[0] != '#') {
+          options.tune_corpus.push_back(InputParse(line));
+        }
+      }
+      if (options.tune_corpus.empty()) {
+        help_and_exit(argc, argv);
+      }
+    } else if (std::strcmp(arg, "--tune-iterations") == 0) {
+      ++i;
+      if (i < argc) {
+        options.tune_config.iterations = std::stoi(std::string{argv[i]});
+      }
+    } else if (std::strcmp(arg, "--perf") == 0) {
+      options.config.perf_counters = true;
+    } else if (std::strcmp(arg, "--estimate") == 0) {
+      options.estimate = true;
+    } else if (std::strcmp(arg, "--verify") == 0) {
+      ++i;
+      if (i >= argc) {
+        help_and_exit(argc, argv);
+      }
+      options.verify_file = argv[i];
+    } else if (std::strcmp(arg, "--threads") == 0) {
+      ++i;
+      if (i < argc) {
+        options.verify_config.thread_num = std::stoi(std::string{argv[i]});
+        options.parallel_config.thread_num = options.verify_config.thread_num;
+        options.parallel = true;
+      }
+    } else if (std::strcmp(arg, "--unordered") == 0) {
+      options.parallel_config.ordered = false;
+    } else if (std::strcmp(arg, "--capture-judge") == 0) {
+      ++i;
+      capture_ofs.open(i < argc ? argv[i] : "");
+      if (!capture_ofs) {
+        help_and_exit(argc, argv);
+      }
+      // Searches may run in parallel (e.g. --portfolio)
+      options.config.on_judge = [&capture_ofs, &capture_mutex](const std::string& line) {
+        std::lock_guard<std::mutex> lock(capture_mutex);
+        capture_ofs << line << '\n';
+      };
+    } else if (std::strcmp(arg, "--no-screen") == 0) {
+      options.screen = false;
+    } else if (std::strcmp(arg, "--stats") == 0) {
+      options.config.stats = true;
+      options.config.all_placement = true;
+    } else if (std::strcmp(arg, "--sweep") == 0) {
+      ++i;
+      std::istringstream ss(i < argc ? argv[i] : "");
+      std::string range;
+      while (std::getline(ss, range, ',')) {
+        // e.g. "P0-9" (or "P3" for a single count)
+        auto pos = range.find_first_of("0123456789");
+        PCVector pc = InputParse(range.substr(0, pos));
+        if (pc.size() != 1 || pos == std::string::npos) {
+          help_and_exit(argc, argv);
+        }
+        auto dash = range.find('-', pos);
+        int min = std::stoi(range.substr(pos, dash - pos));
+        int max = dash == std::string::npos ? min : std::stoi(range.substr(dash + 1));
+        if (min < 0 || max < min) {
+          help_and_exit(argc, argv);
+        }
+        options.sweep_config.ranges.push_back({pc[0], min, max});
+      }
+      if (options.sweep_config.ranges.empty()) {
+        help_and_exit(argc, argv);
+      }
+    } else if (std::strcmp(arg, "--batch") == 0) {
+      ++i;
+      std::ifstream ifs(i < argc ? argv[i] : "");
+      std::string line;
+      while (std::getline(ifs, line)) {
+        std::istringstream ss(line);
+        std::string set;
+        if (ss >> set && set[0] != '#') {
+          options.batch.push_back(InputParse(set));
+          options.batch_lines.push_back(set);
+        }
+      }
+      if (options.batch.empty()) {
+        help_and_exit(argc, argv);
+      }
+    } else if (std::strcmp(arg, "--capacity-table") == 0) {
+      options.capacity_table = true;
     } else if (std::strcmp(arg, "--") == 0) {
       std::cin >> piece_set;
     } else {
@@ -42,25 +883,52 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  if (piece_set.empty()) {
-    help_and_exit(argc, argv);
+  if (!merge_files.empty()) {
+    return MergeMain(merge_files, options.config.all_placement);
   }
 
-  PCVector pc_list = InputParse(piece_set);
-  Search search(config);
+  if (piece_set.empty() && maximize_piece.empty() && options.subproblems.empty() && options.tune_corpus.empty() &&
+      !options.capacity_table && options.batch.empty() && options.sweep_config.ranges.empty()) {
+    help_and_exit(argc, argv);
+  }
 
-  int found_cnt = search.Run(pc_list);
-  if (found_cnt > 0) {
-    for (const auto& sfen : search.AnsSfens()) {
-      std::cout << sfen << std::endl;
+  options.pc_list = InputParse(piece_set);
+  if (std::isfinite(options.local_config.time_limit)) {
+    options.config.deadline = std::chrono::steady_clock::now() +
+                              std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                  std::chrono::duration<double>(options.local_config.time_limit));
+  }
+  if (options.local && options.config.reverse_search) {
+    std::printf("--local does not support -b\n");
+    return EXIT_FAILURE;
+  }
+  if (options.estimate && options.config.reverse_search) {
+    std::printf("--estimate does not support -b\n");
+    return EXIT_FAILURE;
+  }
+  if (!options.batch.empty() && (options.config.reverse_search || options.config.all_placement)) {
+    std::printf("--batch supports neither -a nor -b\n");
+    return EXIT_FAILURE;
+  }
+  if (options.config.stats && options.config.reverse_search) {
+    std::printf("--stats does not support -b\n");
+    return EXIT_FAILURE;
+  }
+  if (!maximize_piece.empty()) {
+    PCVector target = InputParse(maximize_piece);
+    if (target.size() != 1) {
+      help_and_exit(argc, argv);
     }
+    options.maximize_pc = target[0];
+  }
 
-    if (config.all_placement) {
-      std::cout << "found " << found_cnt << " solutions" << std::endl;
-    }
-  } else {
-    std::cout << "not found" << std::endl;
+#define KOMORI_DISPATCH(F, R)           \
+  if (file_num == F && rank_num == R) { \
+    return SearchMain<F, R>(options);   \
   }
+  KOMORI_FOR_EACH_BOARD(KOMORI_DISPATCH)
+#undef KOMORI_DISPATCH
 
-  return EXIT_SUCCESS;
+  std::printf("unsupported board size: %dx%d\n", file_num, rank_num);
+  return EXIT_FAILURE;
 }
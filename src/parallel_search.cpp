@@ -0,0 +1,154 @@
+#include "parallel_search.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace komori {
+namespace {
+/// The number of subproblems per thread, which is enough to balance the load among threads
+constexpr std::size_t kTasksPerThread = 64;
+/// The number of placements which a thread holds before reporting them in unordered mode
+constexpr std::size_t kReportBatch = 1024;
+}  // namespace
+
+template <int F, int R>
+ParallelResult SearchAllParallel(const SearchConfiguration& config,
+                                 const PCVector& pc_list,
+                                 const ParallelConfiguration& parallel_config) {
+  int thread_num =
+      parallel_config.thread_num > 0 ? parallel_config.thread_num : static_cast<int>(std::thread::hardware_concurrency());
+  thread_num = std::max(thread_num, 1);
+
+  ParallelResult result;
+  result.stats = SolutionStats(F, R);
+  auto on_solution = config.on_solution;
+  if (!on_solution) {
+    on_solution = [&result](const std::string& sfen) {
+      result.sfens.push_back(sfen);
+      return true;
+    };
+  }
+
+  SearchConfiguration search_config = config;
+  search_config.all_placement = true;
+  search_config.on_solution = {};
+  BasicSearch<F, R> splitter(search_config);
+  std::vector<BasicSubproblem<F, R>> tasks;
+  for (int depth = 0; depth < static_cast<int>(pc_list.size()); ++depth) {
+    tasks = splitter.Split(pc_list, depth, true);
+    if (tasks.empty() || tasks.size() >= kTasksPerThread * thread_num || splitter.NodeLimitReached()) {
+      break;
+    }
+  }
+  result.node_count = splitter.NodeCount();
+  if (splitter.NodeLimitReached()) {
+    result.interrupted = true;
+    return result;
+  }
+  result.task_cnt = tasks.size();
+  thread_num = std::min(thread_num, static_cast<int>(tasks.size()));
+
+  std::mutex mutex;
+  std::atomic<bool> stopped{false};
+  std::vector<std::unique_ptr<BasicSearch<F, R>>> searches;
+  auto stop_all = [&] {
+    stopped.store(true);
+    for (auto& search : searches) {
+      search->Stop();
+    }
+  };
+  // Pass `sfens` to `on_solution` and clear it. It must be called with `mutex` locked.
+  auto report = [&](std::vector<std::string>& sfens) {
+    for (const auto& sfen : sfens) {
+      if (stopped.load()) {
+        break;
+      }
+      ++result.found_cnt;
+      if (!on_solution(sfen)) {
+        stop_all();
+      }
+    }
+    sfens.clear();
+    return !stopped.load();
+  };
+
+  std::vector<std::vector<std::string>> buffers(thread_num);
+  for (int i = 0; i < thread_num; ++i) {
+    SearchConfiguration worker_config = search_config;
+    worker_config.on_solution = [&, i](const std::string& sfen) {
+      auto& buffer = buffers[i];
+      buffer.push_back(sfen);
+      if (parallel_config.ordered || buffer.size() < kReportBatch) {
+        return true;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      return report(buffer);
+    };
+    searches.push_back(std::make_unique<BasicSearch<F, R>>(worker_config));
+  }
+
+  // In ordered mode, the placements of each subproblem are reported after those of the preceding subproblems
+  std::vector<std::vector<std::string>> task_sfens(tasks.size());
+  std::vector<bool> solved(tasks.size(), false);
+  std::size_t next_report = 0;
+  std::atomic<std::size_t> next_task{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      auto& search = *searches[i];
+      auto& buffer = buffers[i];
+      while (!stopped.load()) {
+        std::size_t task = next_task.fetch_add(1);
+        if (task >= tasks.size()) {
+          break;
+        }
+        search.Solve(tasks[task]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        bool interrupted = search.NodeLimitReached();
+        // An interrupted subproblem is incomplete, so ordered mode reports it only if every preceding one is reported
+        if (!parallel_config.ordered || (interrupted && task == next_report)) {
+          report(buffer);
+        } else if (!interrupted) {
+          task_sfens[task] = std::move(buffer);
+          buffer.clear();
+          solved[task] = true;
+          for (; next_report < tasks.size() && solved[next_report]; ++next_report) {
+            report(task_sfens[next_report]);
+            std::vector<std::string>().swap(task_sfens[next_report]);
+          }
+        }
+
+        if (interrupted) {
+          if (!stopped.load()) {
+            result.interrupted = true;
+            stop_all();
+          }
+          break;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& search : searches) {
+    result.node_count += search->NodeCount();
+    result.stats.Merge(search->Stats());
+  }
+  if (config.stats) {
+    result.found_cnt = result.stats.solutions;
+  }
+  return result;
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                                               \
+  template ParallelResult SearchAllParallel<F, R>(const SearchConfiguration& config, const PCVector& pc_list, \
+                                                  const ParallelConfiguration& parallel_config);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
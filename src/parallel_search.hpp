@@ -0,0 +1,52 @@
+#ifndef KOMORI_PARALLEL_SEARCH_HPP_
+#define KOMORI_PARALLEL_SEARCH_HPP_
+
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+struct ParallelConfiguration {
+  /// The number of threads (0 to use every CPU)
+  int thread_num{0};
+  /**
+   * @brief Report placements in the same order as `BasicSearch::Run()`
+   *
+   * The placements of a subproblem are held until every preceding subproblem is solved. Otherwise, each thread reports
+   * its placements as soon as it has a batch of them.
+   */
+  bool ordered{true};
+};
+
+struct ParallelResult {
+  /// The number of reported placements
+  u64 found_cnt{0};
+  /// The number of nodes of every thread, including those to split the search
+  u64 node_count{0};
+  /// The number of subproblems the search is split into
+  u64 task_cnt{0};
+  /// True if the search was stopped by `node_limit`, `deadline` or `cancel_token` before it completed
+  bool interrupted{false};
+  /// The placements found (empty if `on_solution` is set)
+  std::vector<std::string> sfens{};
+  /// The aggregates merged from every thread if `config.stats` is set
+  SolutionStats stats{};
+};
+
+/**
+ * @brief Find all placements of `pc_list` with threads
+ *
+ * The search is split at the shallowest depth which has enough subproblems for the threads, and each thread takes the
+ * next unsolved subproblem one by one. `config.on_solution` is called by one thread at a time, and the search stops
+ * when it returns false. `config.node_limit` limits the nodes of each thread, and `config.all_placement` is ignored.
+ * With `config.stats`, each thread counts placements into its own aggregates, and `found_cnt` is the total weight.
+ */
+template <int F, int R>
+ParallelResult SearchAllParallel(const SearchConfiguration& config,
+                                 const PCVector& pc_list,
+                                 const ParallelConfiguration& parallel_config);
+}  // namespace komori
+
+#endif  // KOMORI_PARALLEL_SEARCH_HPP_
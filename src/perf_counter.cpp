@@ -0,0 +1,100 @@
+#include "perf_counter.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace komori {
+namespace {
+#ifdef __linux__
+/// The `type` and `config` of `perf_event_attr` of each event
+struct PerfEventConfig {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr PerfEventConfig kPerfEventConfigs[kPerfEventNum] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+/// Open `event` of the calling thread, or return -1 if it is not available
+int OpenEvent(PerfEvent event) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = kPerfEventConfigs[event].type;
+  attr.config = kPerfEventConfigs[event].config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+}  // namespace
+
+const char* PerfEventName(PerfEvent event) {
+  const char* names[kPerfEventNum] = {"cycles", "instructions", "branch-misses", "L1-dcache-load-misses"};
+  return names[event];
+}
+
+const char* PerfPhaseName(PerfPhase phase) {
+  const char* names[kPerfPhaseNum] = {"run", "judge", "report"};
+  return names[phase];
+}
+
+PerfCounters::PerfCounters(void) {
+  for (int event = 0; event < kPerfEventNum; ++event) {
+#ifdef __linux__
+    fds_[event] = OpenEvent(PerfEvent(event));
+#else
+    fds_[event] = -1;
+#endif
+  }
+}
+
+PerfCounters::~PerfCounters(void) {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+PerfValues PerfCounters::Read(void) const {
+  PerfValues values;
+#ifdef __linux__
+  for (int event = 0; event < kPerfEventNum; ++event) {
+    u64 value = 0;
+    if (fds_[event] >= 0 && read(fds_[event], &value, sizeof(value)) == sizeof(value)) {
+      values.value[event] = value;
+    }
+  }
+#endif
+  return values;
+}
+
+bool PerfProfile::IsAnyAvailable(void) const {
+  for (bool event_available : available) {
+    if (event_available) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfProfile::Add(PerfPhase phase, const PerfValues& begin, const PerfValues& end) {
+  ++sampled[phase];
+  for (int event = 0; event < kPerfEventNum; ++event) {
+    values[phase].value[event] += end.value[event] - begin.value[event];
+  }
+}
+}  // namespace komori
@@ -0,0 +1,64 @@
+#ifndef KOMORI_PERF_COUNTER_HPP_
+#define KOMORI_PERF_COUNTER_HPP_
+
+#include "shogi.hpp"
+
+namespace komori {
+/// Hardware events counted by `PerfCounters`
+enum PerfEvent { kPerfCycles, kPerfInstructions, kPerfBranchMisses, kPerfL1dMisses, kPerfEventNum };
+/// The name of `event` in the same style as `perf stat` (e.g. "branch-misses")
+const char* PerfEventName(PerfEvent event);
+
+/// Values of the counters, or the differences of them
+struct PerfValues {
+  u64 value[kPerfEventNum]{};
+};
+
+/**
+ * @brief Hardware performance counters of the calling thread, which are read via Linux `perf_event_open`
+ *
+ * Only events in user space are counted. Each event is opened separately, and an event which cannot be opened (e.g. on
+ * a VM, in a container or with a strict `perf_event_paranoid`) always reads as zero.
+ */
+class PerfCounters {
+ public:
+  PerfCounters(void);
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters(PerfCounters&&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  PerfCounters& operator=(PerfCounters&&) = delete;
+  ~PerfCounters(void);
+
+  bool IsAvailable(PerfEvent event) const { return fds_[event] >= 0; }
+  PerfValues Read(void) const;
+
+ private:
+  int fds_[kPerfEventNum];
+};
+
+/// The phases of the search measured by `PerfCounters`
+enum PerfPhase {
+  kPerfPhaseRun,     ///< The whole search
+  kPerfPhaseJudge,   ///< Pruning of a node by the capacities of pawns and stones
+  kPerfPhaseReport,  ///< Formatting of a placement found
+  kPerfPhaseNum,
+};
+const char* PerfPhaseName(PerfPhase phase);
+
+/// The counters accumulated in each phase of a search
+struct PerfProfile {
+  /// Whether each event could be counted
+  bool available[kPerfEventNum]{};
+  /// The number of times each phase ran
+  u64 calls[kPerfPhaseNum]{};
+  /// The number of times each phase was measured
+  u64 sampled[kPerfPhaseNum]{};
+  /// The sum of the counters of the measured runs of each phase
+  PerfValues values[kPerfPhaseNum]{};
+
+  bool IsAnyAvailable(void) const;
+  void Add(PerfPhase phase, const PerfValues& begin, const PerfValues& end);
+};
+}  // namespace komori
+
+#endif  // KOMORI_PERF_COUNTER_HPP_
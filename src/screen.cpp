@@ -0,0 +1,256 @@
+#include "screen.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace komori {
+namespace {
+/// `dominates[pc][target]` is true if `pc` effects every square which `target` does wherever they are
+template <int F, int R>
+struct DominanceTable {
+  bool dominates[PCNum][PCNum];
+
+  DominanceTable(void) {
+    for (int pc = 0; pc < PCNum; ++pc) {
+      for (int target = 0; target < PCNum; ++target) {
+        bool all = true;
+        for (Square sq = 0; sq < Board<F, R>::kSquareNum && all; ++sq) {
+          all = !(AttackBB<F, R>(PieceType(target), sq) & ~AttackBB<F, R>(PieceType(pc), sq)).isAny();
+        }
+        dominates[pc][target] = all;
+      }
+    }
+  }
+};
+
+template <int F, int R>
+const DominanceTable<F, R>& Dominance(void) {
+  InitAttackBB<F, R>();
+  static const DominanceTable<F, R> kDominance;
+  return kDominance;
+}
+
+/// The name of `pt` in reasons. "P/p" means pawns facing either direction.
+std::string CapacityName(PieceType pt, Color c, bool mixed) {
+  if (mixed && !IsSymmetry(pt)) {
+    return std::string{UsiString(pt)} + "/" + UsiString(Reverse(pt));
+  }
+  return UsiString(c == White && pt != PieceQueen ? Reverse(pt) : pt);
+}
+
+std::string CapacityReason(PieceType pt, Color c, bool mixed, int cnt, int capacity) {
+  return std::to_string(cnt) + " pieces effect every square " + CapacityName(pt, c, mixed) + " does, but only " +
+         std::to_string(capacity) + " " + CapacityName(pt, c, mixed) + " can be placed";
+}
+
+/// Check `pc_list` by the capacity table of the board. It returns the reason if `pc_list` is infeasible.
+template <int F, int R>
+std::string ScreenCapacities(const PCVector& pc_list, bool reverse_search, const CapacityTable& table) {
+  const auto& dominance = Dominance<F, R>();
+  for (int i = 0; i < kCapacityPieceNum; ++i) {
+    PieceType black = kCapacityPieces[i];
+    PieceType white = black != PieceQueen ? Reverse(black) : black;
+    const auto& entry = table.entries[i];
+
+    // In reversible search, a piece counts only if it covers `black` or `white` whichever direction it faces. By the
+    // symmetry of the board, it is the same as the black piece covers either of them.
+    int cnt_b = 0;
+    int cnt_w = 0;
+    int cnt_either = 0;
+    for (auto pc : pc_list) {
+      if (reverse_search) {
+        pc = PieceSetKey(pc, true);
+      }
+      bool b = dominance.dominates[pc][black];
+      bool w = dominance.dominates[pc][white];
+      cnt_b += b;
+      cnt_w += w;
+      cnt_either += b || w;
+    }
+
+    if (!reverse_search && cnt_b > entry.single) {
+      return CapacityReason(black, Black, false, cnt_b, entry.single);
+    } else if (!reverse_search && cnt_w > entry.single) {
+      return CapacityReason(black, White, false, cnt_w, entry.single);
+    } else if (cnt_either > entry.mixed) {
+      return CapacityReason(black, Black, true, cnt_either, entry.mixed);
+    }
+  }
+  return {};
+}
+}  // namespace
+
+template <int F, int R>
+ScreenResult ScreenPieces(const PCVector& pc_list, bool reverse_search) {
+  InitAttackBB<F, R>();
+  InitColumnTable<F, R>();
+  int pc_len = static_cast<int>(pc_list.size());
+  if (pc_len > F * R) {
+    return {true, std::to_string(pc_len) + " pieces exceed " + std::to_string(F * R) + " squares"};
+  }
+
+  if (const auto* table = FindCapacityTable(F, R)) {
+    auto reason = ScreenCapacities<F, R>(pc_list, reverse_search, *table);
+    if (!reason.empty()) {
+      return {true, std::move(reason)};
+    }
+  }
+
+  // A rook-like piece is the only piece in its file and its rank
+  const auto& dominance = Dominance<F, R>();
+  int rook = static_cast<int>(
+      std::count_if(pc_list.begin(), pc_list.end(), [&](PieceType pc) { return dominance.dominates[pc][Rook]; }));
+  if (rook > std::min(F, R)) {
+    return {true, std::to_string(rook) + " rook-like pieces exceed " + std::to_string(std::min(F, R)) + " lines"};
+  } else if (pc_len - rook > (F - rook) * (R - rook)) {
+    return {true, std::to_string(rook) + " rook-like pieces leave " + std::to_string((F - rook) * (R - rook)) +
+                      " squares for " + std::to_string(pc_len - rook) + " pieces"};
+  }
+
+  auto all = allOneBB<F, R>();
+  auto none = allZeroBB<F, R>();
+  if (reverse_search) {
+    int pawn = static_cast<int>(std::count_if(pc_list.begin(), pc_list.end(), [](PieceType pc) {
+      return IsPawnLike<Black>(pc) || IsPawnLike<White>(pc);
+    }));
+    int lance = static_cast<int>(
+        std::count_if(pc_list.begin(), pc_list.end(), [](PieceType pc) { return Pc2Pt(pc) == Lance; }));
+    if (!JudgeColumns(kColumnMixed, all, none, all, pawn, pc_len - pawn, lance)) {
+      return {true, "the files cannot hold " + std::to_string(pawn) + " pawn-like pieces (" + std::to_string(lance) +
+                        " lances) and " + std::to_string(pc_len - pawn) + " others"};
+    }
+  } else {
+    int pawn_b = static_cast<int>(std::count_if(pc_list.begin(), pc_list.end(), IsPawnLike<Black>));
+    int pawn_w = static_cast<int>(std::count_if(pc_list.begin(), pc_list.end(), IsPawnLike<White>));
+    if (!JudgeColumns(kColumnBlack, all, none, all, pawn_b, pc_len - pawn_b)) {
+      return {true, "the files cannot hold " + std::to_string(pawn_b) + " pieces effecting upward and " +
+                        std::to_string(pc_len - pawn_b) + " others"};
+    } else if (!JudgeColumns(kColumnWhite, all, none, all, pawn_w, pc_len - pawn_w)) {
+      return {true, "the files cannot hold " + std::to_string(pawn_w) + " pieces effecting downward and " +
+                        std::to_string(pc_len - pawn_w) + " others"};
+    }
+  }
+  return {};
+}
+
+namespace {
+enum PlaceResult { kPlaced, kUnknown, kUnplaceable };
+
+/// Search a placement of `n` pieces of `pt` within `seconds`
+template <int F, int R>
+PlaceResult TryPlace(PieceType pt, int n, bool mixed, double seconds) {
+  SearchConfiguration config;
+  config.reverse_search = mixed;
+  config.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                           std::chrono::duration<double>(seconds));
+  BasicSearch<F, R> search(config);
+  if (search.Run(PCVector(n, pt)) > 0) {
+    return kPlaced;
+  }
+  return search.NodeLimitReached() ? kUnknown : kUnplaceable;
+}
+
+/// Bound the capacity of `pt`. `placed` pieces are known to be placeable.
+template <int F, int R>
+CapacityProof ProveCapacity(PieceType pt, bool mixed, int placed, double seconds) {
+  CapacityProof proof{placed, F * R + 1};
+  // `lo` is the largest count which is not proved to be unplaceable
+  int lo = placed;
+  int step = 1;
+  while (lo < F * R) {
+    int n = std::min(lo + step, F * R);
+    auto result = TryPlace<F, R>(pt, n, mixed, seconds);
+    if (result == kUnplaceable) {
+      proof.unplaceable = n;
+      break;
+    }
+
+    if (result == kPlaced) {
+      proof.placed = n;
+      step = 1;
+    } else {
+      step *= 2;
+    }
+    lo = n;
+  }
+
+  while (proof.unplaceable - lo > 1) {
+    int mid = (lo + proof.unplaceable) / 2;
+    auto result = TryPlace<F, R>(pt, mid, mixed, seconds);
+    if (result == kUnplaceable) {
+      proof.unplaceable = mid;
+    } else {
+      lo = mid;
+      if (result == kPlaced) {
+        proof.placed = std::max(proof.placed, mid);
+      }
+    }
+  }
+  return proof;
+}
+}  // namespace
+
+template <int F, int R>
+CapacityTable GenerateCapacityTable(
+    double seconds,
+    const std::function<void(PieceType pt, bool mixed, const CapacityProof& proof)>& on_proof) {
+  CapacityTable table{F, R};
+  for (int i = 0; i < kCapacityPieceNum; ++i) {
+    PieceType pt = kCapacityPieces[i];
+    auto& entry = table.entries[i];
+    auto single = ProveCapacity<F, R>(pt, false, 0, seconds);
+    on_proof(pt, false, single);
+    entry.single = single.unplaceable - 1;
+    if (pt == Lance) {
+      // Two lances facing the same direction in a file effect each other, which the search may not prove in time
+      entry.single = std::min(entry.single, F);
+    }
+    if (IsSymmetry(pt)) {
+      entry.mixed = entry.single;
+      continue;
+    }
+
+    // Facing either direction, at least as many pieces as `single.placed` and at most twice as many as `single` fit
+    auto mixed = ProveCapacity<F, R>(pt, true, single.placed, seconds);
+    on_proof(pt, true, mixed);
+    entry.mixed = std::min(mixed.unplaceable - 1, 2 * entry.single);
+    entry.single = std::min(entry.single, entry.mixed);
+  }
+
+  // Pieces which effect every square another type does can be replaced with it, so they never exceed its capacity.
+  // The relation is transitive, so a single pass over the proved capacities is enough.
+  const auto& dominance = Dominance<F, R>();
+  CapacityTable proved = table;
+  for (int i = 0; i < kCapacityPieceNum; ++i) {
+    for (int j = 0; j < kCapacityPieceNum; ++j) {
+      if (dominance.dominates[kCapacityPieces[i]][kCapacityPieces[j]]) {
+        table.entries[i].single = std::min(table.entries[i].single, proved.entries[j].single);
+        table.entries[i].mixed = std::min(table.entries[i].mixed, proved.entries[j].mixed);
+      }
+    }
+  }
+  return table;
+}
+
+std::string CapacityTable2String(const CapacityTable& table) {
+  std::ostringstream ss;
+  ss << "    // " << table.file_num << "x" << table.rank_num << ":";
+  for (auto pt : kCapacityPieces) {
+    ss << " " << UsiString(pt);
+  }
+  ss << "\n    {" << table.file_num << ", " << table.rank_num << ", {";
+  for (int i = 0; i < kCapacityPieceNum; ++i) {
+    ss << (i > 0 ? ", " : "") << "{" << table.entries[i].single << ", " << table.entries[i].mixed << "}";
+  }
+  ss << "}},\n";
+  return ss.str();
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                                                   \
+  template ScreenResult ScreenPieces<F, R>(const PCVector& pc_list, bool reverse_search);                         \
+  template CapacityTable GenerateCapacityTable<F, R>(                                                              \
+      double seconds, const std::function<void(PieceType pt, bool mixed, const CapacityProof& proof)>& on_proof);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
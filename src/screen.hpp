@@ -0,0 +1,83 @@
+#ifndef KOMORI_SCREEN_HPP_
+#define KOMORI_SCREEN_HPP_
+
+#include <functional>
+#include <string>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+/// The piece types of capacity tables. Gold-like pieces (e.g. promoted pawns) are counted as golds.
+constexpr PieceType kCapacityPieces[] = {Pawn, Lance, Knight,    Silver,  Gold,      Bishop,
+                                         Rook, King,  ProBishop, ProRook, PieceQueen};
+constexpr int kCapacityPieceNum = sizeof(kCapacityPieces) / sizeof(kCapacityPieces[0]);
+
+/// Upper bounds of the number of pieces of a type which can be placed without effecting each other
+struct CapacityEntry {
+  /// Every piece faces the same direction
+  int single{0};
+  /// Each piece faces either direction (the same as `single` if the piece is vertically symmetric)
+  int mixed{0};
+};
+
+/// The capacities of `kCapacityPieces` on a board
+struct CapacityTable {
+  int file_num{0};
+  int rank_num{0};
+  CapacityEntry entries[kCapacityPieceNum]{};
+};
+
+/// Get the embedded capacity table of the board (nullptr if it is not embedded)
+const CapacityTable* FindCapacityTable(int file_num, int rank_num);
+
+/// The result of `ScreenPieces`
+struct ScreenResult {
+  /// True if it is proved that the pieces cannot be placed
+  bool infeasible{false};
+  /// Why the pieces cannot be placed (empty if `infeasible` is false)
+  std::string reason{};
+};
+
+/**
+ * @brief Check the necessary conditions for placing `pc_list` without searching
+ *
+ * The checks are:
+ * - the number of pieces does not exceed the number of squares,
+ * - for each type of `kCapacityPieces`, the pieces which effect every square the type does never exceed its capacity,
+ * - the pieces other than rook-like ones fit the files and ranks which rook-like pieces leave,
+ * - pawn-like pieces (see `IsPawnLike`) and the rest fit the files of the empty board (see `JudgeColumns`).
+ *
+ * It takes only microseconds, and no feasible `pc_list` is ever rejected.
+ */
+template <int F, int R>
+ScreenResult ScreenPieces(const PCVector& pc_list, bool reverse_search);
+
+/// How a capacity is bounded by `GenerateCapacityTable`
+struct CapacityProof {
+  /// The most pieces which are found to be placeable
+  int placed{0};
+  /// The fewest pieces which are proved to be unplaceable (the capacity is `unplaceable - 1`)
+  int unplaceable{0};
+};
+
+/**
+ * @brief Compute the capacity table of the board by the search
+ *
+ * The capacity of a type is the fewest pieces which the search proves to be unplaceable within `seconds`, minus one.
+ * The counts are tried one by one while placements are found, and then with doubling steps and bisection, because
+ * proving a count far beyond the maximum is often much faster. The capacity is exact if it equals `placed`. Lances
+ * facing one direction are also bounded by the number of files, since two of them in a file effect each other.
+ *
+ * @param on_proof Called with each type and orientation (`mixed` is true if pieces face either direction)
+ */
+template <int F, int R>
+CapacityTable GenerateCapacityTable(
+    double seconds,
+    const std::function<void(PieceType pt, bool mixed, const CapacityProof& proof)>& on_proof);
+
+/// Get a string of `table` in the format of the embedded tables (see `capacity_table.cpp`)
+std::string CapacityTable2String(const CapacityTable& table);
+}  // namespace komori
+
+#endif  // KOMORI_SCREEN_HPP_
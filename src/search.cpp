@@ -1,14 +1,41 @@
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <fstream>
 #include <map>
-#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 
+#include "column_judge.hpp"
+#include "column_table.hpp"
 #include "search.hpp"
 #include "shogi.hpp"
 
 using namespace komori;
 
 namespace {
+// Queen -> ProRook -> ProBishop     (Strong Long Effect Piece)
+// -> Rook -> Bishop -> Lance        (Long Effect Piece)
+// -> King -> Gold, ProXXX -> Silver (Metal Piece)
+// -> Knight -> Pawn -> Stone        (Weak Piece)
+constexpr int kDefaultOrderTable[PCNum] = {
+    305,                 // BStone
+    303, 110, 301, 213,  // BPawn, BLance, BKnight, BSilver
+    108, 106, 203, 201,  // BBishop, BRook, BGold, BKing
+    204, 205, 206, 207,  // BProGolds
+    104, 102,            // BProBishop, BProRook
+    0,                   // None
+    305,                 // WStone
+    304, 111, 302, 214,  // WPawn, WLance, WKnight, WSilver
+    109, 107, 208, 202,  // WBishop, WRook, WGold, WKing
+    209, 210, 211, 212,  // WProGolds
+    105, 103,            // BProBishop, BProRook
+    101,                 // Queen
+    0,                   // None
+};
+
 /**
  * @brief A function object to sort a PCVector by decending order of strength
  *
@@ -16,30 +43,100 @@ namespace {
  * This structs enables to sort PCVector by strength ordering heuristically.
  */
 struct PCSortObject {
+  /**
+   * @brief Make the ordering from `table` (`kDefaultOrderTable` if it is empty)
+   *
+   * A nonzero `seed` shuffles the order of pieces in each group of strength at random.
+   */
+  PCSortObject(u64 seed, const std::vector<int>& table) {
+    std::mt19937_64 rng(seed);
+    for (int pc = 0; pc < PCNum; ++pc) {
+      int value = table.empty() ? kDefaultOrderTable[pc] : table[pc];
+      value_table_[pc] = value;
+      if (seed != 0 && value != 0) {
+        // Keep the group (hundreds digit) and break ties by the piece itself, so that identical pieces stay adjacent
+        value_table_[pc] = (value / 100 * 100 + static_cast<int>(rng() % 100)) * PCNum + pc;
+      }
+    }
+  }
+
+  /// Ties are broken by the piece itself, so that identical pieces are always adjacent
   bool operator()(const PieceType& l, const PieceType& r) const {
-    // Queen -> ProRook -> ProBishop     (Strong Long Effect Piece)
-    // -> Rook -> Bishop -> Lance        (Long Effect Piece)
-    // -> King -> Gold, ProXXX -> Silver (Metal Piece)
-    // -> Knight -> Pawn -> Stone        (Weak Piece)
-    constexpr int kValueTable[PCNum] = {
-        305,                 // BStone
-        303, 110, 301, 213,  // BPawn, BLance, BKnight, BSilver
-        108, 106, 203, 201,  // BBishop, BRook, BGold, BKing
-        204, 205, 206, 207,  // BProGolds
-        104, 102,            // BProBishop, BProRook
-        0,                   // None
-        305,                 // WStone
-        304, 111, 302, 214,  // WPawn, WLance, WKnight, WSilver
-        109, 107, 208, 202,  // WBishop, WRook, WGold, WKing
-        209, 210, 211, 212,  // WProGolds
-        105, 103,            // BProBishop, BProRook
-        101,                 // Queen
-        0,                   // None
-    };
-    return kValueTable[l] < kValueTable[r];
+    return value_table_[l] != value_table_[r] ? value_table_[l] < value_table_[r] : l < r;
   }
+
+  int value_table_[PCNum];
 };
 
+/// Judge if `pc` is written in order tables. Stones of both colors share the same entry.
+bool HasOrderEntry(PieceType pc) {
+  return kDefaultOrderTable[pc] != 0 && pc != (Stone | PTWhiteFlag);
+}
+
+/// Judge if `pc` has an effect which reaches the edge of the board
+bool IsLongRange(PieceType pc) {
+  switch (Pc2Pt(pc)) {
+    case Lance:
+    case Bishop:
+    case Rook:
+    case ProBishop:
+    case ProRook:
+    case PieceQueen:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Get the piece which can replace `pc` in the search
+ *
+ * It is the first piece whose effects from every square are the same as those of `pc` (e.g. Gold for ProPawn, Rook for
+ * WhiteRook). `pc` itself is returned if it is not a piece of order tables (e.g. PieceEmpty).
+ */
+template <int F, int R>
+PieceType SameEffectPiece(PieceType pc) {
+  if (kDefaultOrderTable[pc] == 0) {
+    return pc;
+  }
+
+  for (int other = 0; other < pc; ++other) {
+    if (kDefaultOrderTable[other] == 0 || IsPawnLike<Black>(PieceType(other)) != IsPawnLike<Black>(pc) ||
+        IsPawnLike<White>(PieceType(other)) != IsPawnLike<White>(pc)) {
+      continue;
+    }
+
+    bool same = true;
+    for (Square sq = 0; sq < Board<F, R>::kSquareNum && same; ++sq) {
+      same = AttackBB<F, R>(PieceType(other), sq) == AttackBB<F, R>(pc, sq);
+    }
+    if (same) {
+      return PieceType(other);
+    }
+  }
+  return pc;
+}
+
+/**
+ * @brief Judge if no pawn-like piece other than pawns follows a pawn of `C` in `pc_list`
+ *
+ * If so, the rest of pawn-like pieces are all pawns while pawns are placed, and they must be placed on squares greater
+ * than the last pawn.
+ */
+template <Color C>
+bool IsPawnsLast(const PCVector& pc_list) {
+  PieceType pawn = C == Black ? BlackPawn : WhitePawn;
+  bool pawn_found = false;
+  for (auto pc : pc_list) {
+    if (pc == pawn) {
+      pawn_found = true;
+    } else if (pawn_found && IsPawnLike<C>(pc)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Count the number of pawn-like pieces
 template <Color C>
 int CountPawnLike(const PCVector& pc_list) {
@@ -51,230 +148,304 @@ int CountPawnLikeEither(const PCVector& pc_list) {
   return std::count_if(pc_list.begin(), pc_list.end(),
                        [](const PieceType& pc) { return IsPawnLike<Black>(pc) || IsPawnLike<White>(pc); });
 }
+}  // namespace
 
-template <Color C>
-Bitboard PawnPlaceable(Bitboard no_effect_bb, Bitboard pieces_bb) {
-  return no_effect_bb & ~pieces_bb.down<C>();
+namespace komori {
+std::vector<int> DefaultOrderTable(void) {
+  return std::vector<int>(std::begin(kDefaultOrderTable), std::end(kDefaultOrderTable));
 }
 
-/// Judge if `pawn`s and `stone`s are placeable in `no_effect_bb`
-template <Color C>
-bool JudgePlaceable(Bitboard no_effect_bb, int pawn, int stone, Bitboard pawn_allowed) {
-  int empty_num = no_effect_bb.popCount();
+std::vector<int> LoadOrderTable(const std::string& path) {
+  std::ifstream ifs(path);
+  if (!ifs) {
+    throw std::runtime_error("cannot open " + path);
+  }
 
-  if (empty_num < pawn + stone) {
-    return false;
+  std::vector<int> table = DefaultOrderTable();
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream ss(line);
+    std::string piece;
+    int value;
+    if (!(ss >> piece) || piece[0] == '#') {
+      continue;
+    }
+    if (!(ss >> value) || value <= 0) {
+      throw std::runtime_error("broken line in order table: " + line);
+    }
+
+    bool found = false;
+    for (int pc = 0; pc < PCNum; ++pc) {
+      if (HasOrderEntry(PieceType(pc)) && piece == UsiString(PieceType(pc))) {
+        table[pc] = value;
+        found = true;
+      }
+    }
+    if (!found) {
+      throw std::runtime_error("unknown piece in order table: " + piece);
+    }
   }
+  table[Stone | PTWhiteFlag] = table[Stone];
+  return table;
+}
 
-  // A bitboard which is allowed to place pawn and is not effected by other pieces
-  Bitboard next_placement = pawn_allowed & ~no_effect_bb.down<C>();
-  int next_count = next_placement.popCount();
-  if (next_count >= pawn) {
-    return true;
+std::string OrderTable2String(const std::vector<int>& table) {
+  std::ostringstream ss;
+  for (int pc = 0; pc < PCNum; ++pc) {
+    if (HasOrderEntry(PieceType(pc))) {
+      ss << UsiString(PieceType(pc)) << " " << table[pc] << "\n";
+    }
+  }
+  return ss.str();
+}
+
+template <int F, int R>
+BasicSearch<F, R>::BasicSearch(const SearchConfiguration& config) : config_{config} {
+  InitAttackBB<F, R>();
+  InitColumnTable<F, R>();
+}
+
+template <int F, int R>
+void BasicSearch<F, R>::BuildAttackRows(const PCVector& pc_list, bool reversible) {
+  attack_rows_.clear();
+  attack_row_index_.clear();
+  for (std::size_t depth = 0; depth < pc_list.size(); ++depth) {
+    PieceType pc = pc_list[depth];
+    if (depth == 0 || pc_list[depth - 1] != pc) {
+      for (PieceType row_pc : {pc, Reverse(pc)}) {
+        AttackRow row;
+        for (Square sq = 0; sq < kSquareNum; ++sq) {
+          row.attack[sq] = AttackBB<F, R>(row_pc, sq);
+        }
+        attack_rows_.push_back(row);
+        if (!reversible) {
+          break;
+        }
+      }
+    }
+    attack_row_index_.push_back(static_cast<int>(attack_rows_.size()) - (reversible ? 2 : 1));
   }
+}
 
-  do {
-    // Place pawns to `next_placement`
-    pawn_allowed &= ~(next_placement | next_placement.up<C>() | next_placement.down<C>());
-    no_effect_bb &= ~(next_placement | next_placement.up<C>());
-    pawn -= next_count;
+template <int F, int R>
+bool BasicSearch<F, R>::Poll(void) {
+  if (node_count_ >= config_.node_limit || stop_.load(std::memory_order_relaxed) ||
+      config_.cancel_token.IsCancelled() || std::chrono::steady_clock::now() >= config_.deadline) {
+    interrupted_ = true;
+    return true;
+  }
 
-    // Recalculate next placement bitboard
-    next_placement = pawn_allowed & ~no_effect_bb.up<C>();
-    next_count = next_placement.popCount();
-  } while (next_count > 0 && next_count < pawn);
+  next_poll_ = std::min(node_count_ + kPollInterval, config_.node_limit);
+  return false;
+}
 
-  // (#(pawns to be placed) >= pawn) and (#(empty place) >= stone)
-  return (next_count >= pawn && no_effect_bb.popCount() - 2 * pawn >= stone);
+template <int F, int R>
+void BasicSearch<F, R>::CaptureJudge(const JudgeInput& input) {
+  if (judge_count_++ % kJudgeSampleInterval == 0) {
+    config_.on_judge(JudgeInput2String(input));
+  }
 }
 
-/// Judge if `pawn's and `stone`s are placeable in `no_effect_bb` (both direction is ok)
-bool JudgeNonDirectionalPlacement(Bitboard no_effect_bb, int pawn, int stone, Bitboard pieces) {
-  int empty_num = no_effect_bb.popCount();
+template <int F, int R>
+void BasicSearch<F, R>::Report(std::string sfen, std::vector<std::string>& ans) {
+  if (config_.on_solution) {
+    if (!config_.on_solution(sfen)) {
+      Stop();
+      // Poll at the next node to stop immediately
+      next_poll_ = 0;
+    }
+  } else {
+    ans.push_back(std::move(sfen));
+  }
+}
 
-  if (empty_num < pawn + stone) {
-    return false;
+template <int F, int R>
+int BasicSearch<F, R>::ReportPlacement(const PiecePositions& pieces_log, std::vector<std::string>& ans) {
+  if (labels_.empty()) {
+    Report(Pieces2Sfen<F, R>(pieces_log), ans);
+    return 1;
   }
 
-  // Case 1: The abose square is effected.
-  //   One pawns can be places per an empty square
+  PiecePositions pieces(pieces_log);
+  PCVector labels(labels_);
+  int found_cnt = 0;
+  for (;;) {
+    for (std::size_t i = 0; i < pieces.size(); ++i) {
+      pieces[i].pc = labels[i];
+    }
+    Report(Pieces2Sfen<F, R>(pieces), ans);
+    ++found_cnt;
+    if (!config_.all_placement || stop_.load(std::memory_order_relaxed)) {
+      break;
+    }
+
+    // Count up the permutations of runs like an odometer. `std::next_permutation` returns false after it restores the
+    // first (sorted) permutation.
+    auto itr = std::find_if(label_runs_.rbegin(), label_runs_.rend(), [&labels](const std::pair<int, int>& run) {
+      return std::next_permutation(labels.begin() + run.first, labels.begin() + run.second);
+    });
+    if (itr == label_runs_.rend()) {
+      break;
+    }
+  }
+  return found_cnt;
+}
 
-  // Place pawns as many as possible on the squares applying the following all.
-  // - above is empty
-  // - above is effected
-  // - here is not effected
-  Bitboard next_placement_b = ~pieces.down<Black>() & ~no_effect_bb.down<Black>() & no_effect_bb;
-  Bitboard next_placement_w = ~pieces.down<White>() & ~no_effect_bb.down<White>() & ~next_placement_b & no_effect_bb;
-  int next_count = next_placement_b.popCount() + next_placement_w.popCount();
-  if (next_count >= pawn) {
-    return true;
+template <int F, int R>
+int BasicSearch<F, R>::RecordStats(const PiecePositions& pieces_log, const Bitboard& no_effect_bb) {
+  using Geometry = Board<F, R>;
+  // The runs of merged pieces are ordered like an odometer by `ReportPlacement`, so the weight is the product of the
+  // numbers of distinct permutations of the runs. Each prefix of a sorted run has an integral number of them.
+  u64 weight = 1;
+  for (const auto& run : label_runs_) {
+    for (int i = run.first; i < run.second; ++i) {
+      weight = weight * (i - run.first + 1) /
+               std::count(labels_.begin() + run.first, labels_.begin() + i + 1, labels_[i]);
+    }
   }
 
-  // Case 2: 3 consecutive squares are empty.
-  //   Two pawns can be placed per three empty squares
-  do {
-    // Place pawns to `next_placement_b` and `next_placement_w`
-    pieces |= next_placement_b | next_placement_w;
-    // - pawn placed        -> piece exists
-    // - pawn_w placed      -> piece exists
-    // - (pawn placed).up   -> effect
-    // - (pawn placed_v).up -> effect
-    no_effect_bb &=
-        ~(next_placement_b | next_placement_w | next_placement_b.up<Black>() | next_placement_w.up<White>());
-    pawn -= next_count;
-
-    // condition:
-    //     p
-    //     (no piece)
-    //     P
-    //     (effect)
-    // centinel is not needed because edge pawn is already placed if possible.
-    next_placement_b =
-        (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb & no_effect_bb.down<Black>().down<Black>());
-    next_placement_w = next_placement_b.up<Black>().up<Black>();
-    next_count = 2 * next_placement_b.popCount();
-  } while (next_count > 0 && next_count < pawn);
-
-  if (next_count >= pawn) {
-    int space = no_effect_bb.popCount() - pawn / 2 * 3;
-    if (pawn % 2 == 1) {
-      space -= 2;
-    }
-    return space >= stone;
-  }
-
-  // Case 3: 2 consecutive squares are empty.
-  //   One pawns can be placed per two empty squares
-  next_placement_b = (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb);
-  next_count = next_placement_b.popCount();
-  while (next_count > 0 && next_count < pawn) {
-    pieces |= next_placement_b;
-    no_effect_bb &= (next_placement_b & next_placement_b.up<Black>());
-    pawn -= next_count;
-
-    next_placement_b = (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb);
-    next_count = next_placement_b.popCount();
-  }
-
-  // (#(pawn placeable square) >= pawn) and (#(empty place) >= stone)
-  return (next_count >= pawn && no_effect_bb.popCount() - 2 * pawn >= stone);
-}
-
-bool GetNonDirectionalPlacement(Bitboard no_effect_bb,
-                                int pawn,
-                                int stone,
-                                Bitboard pieces,
-                                Bitboard& pawn_b,
-                                Bitboard& pawn_w) {
-  int empty_num = no_effect_bb.popCount();
-  pawn_b = allZeroBB();
-  pawn_w = allZeroBB();
-
-  if (empty_num < pawn + stone) {
-    return false;
-  }
-
-  // place pawn whose above square is effected
-  Bitboard next_placement_b = ~pieces.down<Black>() & ~no_effect_bb.down<Black>() & no_effect_bb;
-  Bitboard next_placement_w = ~pieces.down<White>() & ~no_effect_bb.down<White>() & ~next_placement_b & no_effect_bb;
-  int next_count = next_placement_b.popCount() + next_placement_w.popCount();
-  if (next_count >= pawn) {
-    goto FOUND;
-  }
-
-  do {
-    pawn_b |= next_placement_b;
-    pawn_w |= next_placement_w;
-    pieces |= next_placement_b | next_placement_w;
-    no_effect_bb &=
-        ~(next_placement_b | next_placement_w | next_placement_b.up<Black>() | next_placement_w.up<White>());
-    pawn -= next_count;
-
-    // centinel is not needed because edge pawn is already placed if possible.
-    next_placement_b =
-        (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb & no_effect_bb.down<Black>().down<Black>());
-    next_placement_w = next_placement_b.up<Black>().up<Black>();
-    next_count = 2 * next_placement_b.popCount();
-  } while (next_count > 0 && next_count < pawn);
-
-  if (next_count >= pawn) {
-    int space = no_effect_bb.popCount() - pawn / 2 * 3;
-    if (pawn % 2 == 1) {
-      space -= 2;
-    }
-    if (space >= stone) {
-      goto FOUND;
+  std::size_t run = 0;
+  for (int i = 0; i < static_cast<int>(pieces_log.size()); ++i) {
+    Square sq = pieces_log[i].sq;
+    int file = Geometry::GetFile(sq);
+    int rank = Geometry::GetRank(sq);
+    if (run < label_runs_.size() && i >= label_runs_[run].second) {
+      ++run;
+    }
+
+    if (run < label_runs_.size() && i >= label_runs_[run].first) {
+      // Each label of the run is at `sq` in the share of the permutations in proportion to its count
+      auto [first, last] = label_runs_[run];
+      for (int j = first; j < last; ++j) {
+        if (j == first || labels_[j] != labels_[j - 1]) {
+          u64 cnt = std::count(labels_.begin() + first, labels_.begin() + last, labels_[j]);
+          stats_.Occupancy(labels_[j], file, rank) += weight * cnt / (last - first);
+        }
+      }
     } else {
-      return false;
+      stats_.Occupancy(labels_.empty() ? pieces_log[i].pc : labels_[i], file, rank) += weight;
     }
   }
+  stats_.solutions += weight;
+  stats_.free_squares[no_effect_bb.popCount()] += weight;
+  return static_cast<int>(weight);
+}
 
-  next_placement_b = (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb);
-  next_count = next_placement_b.popCount();
-  while (next_count > 0 && next_count < pawn) {
-    pawn_b |= next_placement_b;
-    pawn_w |= next_placement_w;
-    pieces |= next_placement_b;
-    no_effect_bb &= (next_placement_b & next_placement_b.up<Black>());
-    pawn -= next_count;
+template <int F, int R>
+const Square* BasicSearch<F, R>::OrderSquares(PieceType pc,
+                                              Bitboard candidate_bb,
+                                              const Bitboard& no_effect_bb,
+                                              Square* order) const {
+  using Geometry = Board<F, R>;
+  // key = (#(empty squares effected) * 8 + distance from the edge) * 256 + tie breaker
+  bool long_range = IsLongRange(pc);
+  int keys[kSquareNum];
+  int len = 0;
+  while (candidate_bb.isAny()) {
+    Square sq = PopSquare(candidate_bb);
+    int score = (AttackBB<F, R>(pc, sq) & no_effect_bb).popCount() * 8;
+    if (long_range) {
+      int file = Geometry::GetFile(sq);
+      int rank = Geometry::GetRank(sq);
+      score += std::min({file, F - 1 - file, rank, R - 1 - rank});
+    }
+    keys[len] = score * 256 + len;
+    order[len++] = sq;
+  }
 
-    next_placement_b = (~pieces.down<Black>() & ~no_effect_bb.up<Black>() & no_effect_bb);
-    next_placement_w = allZeroBB();
-    next_count = next_placement_b.popCount();
+  std::sort(keys, keys + len);
+  Square sorted[kSquareNum];
+  for (int i = 0; i < len; ++i) {
+    sorted[i] = order[keys[i] % 256];
   }
+  std::copy(sorted, sorted + len, order);
+  return order;
+}
 
-  // (#(pawn placeable square) >= pawn) and (#(empty place) >= stone)
-  if (next_count >= pawn && no_effect_bb.popCount() - 2 * pawn >= stone) {
-    goto FOUND;
-  } else {
-    return false;
+template <int F, int R>
+int BasicSearch<F, R>::Run(const PCVector& pc_list) {
+  perf_profile_ = PerfProfile{};
+  if (config_.perf_counters) {
+    // Counters are opened here because they count only the thread which opens them
+    perf_counters_ = std::make_unique<PerfCounters>();
+    for (int event = 0; event < kPerfEventNum; ++event) {
+      perf_profile_.available[event] = perf_counters_->IsAvailable(PerfEvent(event));
+    }
   }
 
-FOUND:
-  while (pawn > 0) {
-    if (next_placement_b) {
-      Square sq = next_placement_b.firstOneFromSQ11();
-      pawn_b |= SquareMaskBB(sq);
+  int found_cnt = Measure(kPerfPhaseRun, [&] {
+    if (config_.reverse_search) {
+      return RunReversible(pc_list);
     } else {
-      Square sq = next_placement_w.firstOneFromSQ11();
-      pawn_w |= SquareMaskBB(sq);
+      return RunUnreversible(pc_list);
     }
-    --pawn;
-  }
-  return true;
+  });
+  perf_counters_.reset();
+  return found_cnt;
 }
-}  // namespace
 
-namespace komori {
-Search::Search(const SearchConfiguration& config) : config_{config} {
-  static std::once_flag once;
-  std::call_once(once, InitAttackBB);
-}
+template <int F, int R>
+PCVector BasicSearch<F, R>::PrepareUnreversible(const PCVector& pc_list) {
+  PieceType merged[PCNum];
+  for (int pc = 0; pc < PCNum; ++pc) {
+    merged[pc] = merge_pieces_ ? SameEffectPiece<F, R>(PieceType(pc)) : PieceType(pc);
+  }
 
-int Search::Run(const PCVector& pc_list) {
-  if (config_.reverse_search) {
-    return RunReversible(pc_list);
-  } else {
-    return RunUnreversible(pc_list);
+  // Sorting `pc_list` enables purning more effectively. The labels of each run are sorted for `ReportPlacement`.
+  PCSortObject sort_object{config_.order_seed, config_.order_table};
+  labels_ = pc_list;
+  std::sort(labels_.begin(), labels_.end(), [&](PieceType l, PieceType r) {
+    return merged[l] != merged[r] ? sort_object(merged[l], merged[r]) : l < r;
+  });
+  PCVector pc_list_sorted;
+  for (auto pc : labels_) {
+    pc_list_sorted.push_back(merged[pc]);
   }
+  BuildLabelRuns(pc_list_sorted);
+
+  pawns_last_[Black] = IsPawnsLast<Black>(pc_list_sorted);
+  pawns_last_[White] = IsPawnsLast<White>(pc_list_sorted);
+  BuildAttackRows(pc_list_sorted, false);
+  return pc_list_sorted;
 }
 
-int Search::RunUnreversible(const PCVector& pc_list) {
-  // Sorting `pc_list` enables purning more effectively
-  PCVector pc_list_sorted(pc_list);
-  std::sort(pc_list_sorted.begin(), pc_list_sorted.end(), PCSortObject{});
+template <int F, int R>
+void BasicSearch<F, R>::BuildLabelRuns(const PCVector& pc_list) {
+  label_runs_.clear();
+  for (std::size_t i = 0; i < labels_.size();) {
+    std::size_t j = i;
+    while (j < labels_.size() && pc_list[j] == pc_list[i]) {
+      ++j;
+    }
+    if (labels_[i] != labels_[j - 1]) {
+      label_runs_.push_back({static_cast<int>(i), static_cast<int>(j)});
+    }
+    i = j;
+  }
+  if (labels_ == pc_list) {
+    labels_.clear();
+  }
+}
 
+template <int F, int R>
+int BasicSearch<F, R>::RunUnreversible(const PCVector& pc_list) {
+  PCVector pc_list_sorted = PrepareUnreversible(pc_list);
   int pawn_b = CountPawnLike<Black>(pc_list_sorted);
   int pawn_w = CountPawnLike<White>(pc_list_sorted);
 
   PiecePositions pieces_log;
-  return SearchImpl(pc_list_sorted, pawn_b, pawn_w, allOneBB(), allZeroBB(), 0, 0, pieces_log, ans_sfens_);
+  int found_cnt =
+      SearchImpl(pc_list_sorted, pawn_b, pawn_w, allOneBB<F, R>(), allZeroBB<F, R>(), 0, 0, pieces_log, ans_sfens_);
+  for (std::size_t i = 0; i < deepest_.size() && !labels_.empty(); ++i) {
+    deepest_[i].pc = labels_[i];
+  }
+  return found_cnt;
 }
 
-int Search::RunReversible(const PCVector& pc_list) {
-  PCVector symmetry_list;
+template <int F, int R>
+int BasicSearch<F, R>::RunReversible(const PCVector& pc_list) {
+  PCVector search_list;
   int asymmetry_len[PieceTypeNum] = {0};
-  int flip_len[PieceTypeNum] = {0};
   int pawn = 0;
   int lance = 0;
   int stone = 0;
@@ -286,78 +457,61 @@ int Search::RunReversible(const PCVector& pc_list) {
   // Analyze the passed `pc_list`.
   // - pawn, stone
   // - (vertically) symmetric pieces (Rook, Bishop, Queen, King)
-  // - (vertically) assymmetric pieces (other)
+  // - (vertically) assymmetric pieces (other), whose directions are chosen in search
   for (PieceType pc : pc_list) {
     PieceType pt = SimplifyGold(Pc2Pt(pc));
     if (pt == Pawn) {
-      // Lance is treated as Pawn in order to speed up
       pawn++;
     } else if (pt == Lance) {
+      // A lance is searched as a pawn with no piece in front of it, which is placed at the leaf
       pawn++;
       lance++;
     } else if (pt == Stone) {
       stone++;
-    } else if (IsSymmetry(pt)) {
-      symmetry_list.push_back(pt);
     } else {
-      asymmetry_len[pt]++;
+      search_list.push_back(pt);
+      if (!IsSymmetry(pt)) {
+        asymmetry_len[pt]++;
+      }
     }
   }
 
-  // By horizontal symmetricity, skip the first half ot search
+  // The board rotated by 180 degrees with every direction flipped is also a solution. Skip the half of the search by
+  // requiring that at least half of one asymmetric piece type face upward. A type with an odd number of pieces breaks
+  // the symmetry exactly.
+  flip_pt_ = PieceEmpty;
   for (int i = PieceTypeNum - 1; i >= 0; --i) {
-    if (asymmetry_len[i] > 0) {
-      flip_len[i] = (asymmetry_len[i] + 1) / 2;
+    if (asymmetry_len[i] > 0 && (flip_pt_ == PieceEmpty || asymmetry_len[i] % 2 == 1)) {
+      flip_pt_ = PieceType(i);
       if (asymmetry_len[i] % 2 == 1) {
         break;
       }
     }
   }
-
-  // Try all conbination of piece directions
-  int found_cnt = 0;
-  for (;;) {
-    PCVector pc_list(symmetry_list);
-    for (int i = 0; i < PieceTypeNum; ++i) {
-      for (int j = 0; j < flip_len[i]; ++j) {
-        pc_list.push_back(PieceType(i));
-      }
-      for (int j = flip_len[i]; j < asymmetry_len[i]; ++j) {
-        pc_list.push_back(PieceType(i | PTWhiteFlag));
-      }
+  flip_need_ = flip_pt_ != PieceEmpty ? (asymmetry_len[flip_pt_] + 1) / 2 : 0;
+
+  std::sort(search_list.begin(), search_list.end(), PCSortObject{config_.order_seed, config_.order_table});
+  // Place the first half of each piece type upward and the rest downward first. A mixed placement is usually easier
+  // because pieces of the both directions can be packed together.
+  reverse_first_.assign(search_list.size(), false);
+  for (std::size_t i = 0; i < search_list.size();) {
+    std::size_t j = i;
+    while (j < search_list.size() && search_list[j] == search_list[i]) {
+      ++j;
     }
-    std::sort(pc_list.begin(), pc_list.end(), PCSortObject{});
-
-    int search_pawn = pawn + CountPawnLikeEither(pc_list);
-    int search_stone = stone + (pc_list.size() - CountPawnLikeEither(pc_list));
-    PiecePositions pieces_log;
-    found_cnt += SearchImplReversiblePawn(pc_list, search_pawn, search_stone, lance, allOneBB(), allZeroBB(), 0, 0,
-                                          pieces_log, ans_sfens_);
-
-    if (!config_.all_placement && found_cnt > 0) {
-      goto END;
-    }
-
-    // next combination
-    for (int i = 0; i < PieceTypeNum; ++i) {
-      if (asymmetry_len[i] > 0) {
-        // check carry-up
-        if (flip_len[i] >= asymmetry_len[i]) {
-          flip_len[i] = 0;
-        } else {
-          flip_len[i]++;
-          break;
-        }
-      }
-
-      // if (last combination) break;
-      if (i == PieceTypeNum - 1) {
-        goto END;
-      }
+    for (std::size_t k = i + (j - i + 1) / 2; k < j; ++k) {
+      reverse_first_[k] = true;
     }
+    i = j;
   }
 
-END:
+  BuildAttackRows(search_list, true);
+  int search_pawn = pawn + CountPawnLikeEither(search_list);
+  int search_stone = stone + (search_list.size() - CountPawnLikeEither(search_list));
+  PiecePositions pieces_log;
+  int found_cnt = SearchImplReversiblePawn(search_list, search_pawn, search_stone, lance, 0, allOneBB<F, R>(),
+                                           allZeroBB<F, R>(), 0, 0, pieces_log, ans_sfens_);
+
   std::vector<PieceType> golds;
   for (const auto& pc : pc_list) {
     auto pt = Pc2Pt(pc);
@@ -382,67 +536,505 @@ END:
     sfen = std::move(modified_sfen);
   }
 
+  if (config_.on_solution) {
+    // The golds are restored only here, so the placements are passed to the callback after the search
+    std::vector<std::string> sfens;
+    sfens.swap(ans_sfens_);
+    for (auto& sfen : sfens) {
+      Report(std::move(sfen), ans_sfens_);
+    }
+  }
+
   return found_cnt;
 }
 
-int Search::SearchImpl(const PCVector& pc_list,
-                       int pawn_b,
-                       int pawn_w,
-                       Bitboard no_effect_bb,
-                       Bitboard pieces_bb,
-                       int depth,
-                       Square last_sq,
-                       PiecePositions& pieces_log,
-                       std::vector<std::string>& ans) {
-  int pc_len = static_cast<int>(pc_list.size());
+template <int F, int R>
+int BasicSearch<F, R>::Maximize(const PCVector& pc_list, PieceType target) {
+  if (config_.reverse_search || config_.all_placement) {
+    throw std::runtime_error("maximize is only allowed in unidirectional search for a placement");
+  }
 
-  if (depth >= pc_len) {
-    // Found a placement
-    ans.push_back(Pieces2Sfen(pieces_log));
-    return 1;
+  // Extra `target`s as many as the empty squares are added, so that they are sorted and merged in the same way as
+  // `Run` does. At least one is added to make the run of `target`.
+  int capacity = std::max(F * R - static_cast<int>(pc_list.size()), 1);
+  PCVector pc_list_extended(pc_list);
+  pc_list_extended.insert(pc_list_extended.end(), capacity, target);
+  PCVector pc_list_sorted = PrepareUnreversible(pc_list_extended);
+  PCVector labels = labels_.empty() ? pc_list_sorted : labels_;
+
+  MaximizeState state;
+  state.target = pc_list_sorted[std::find(labels.begin(), labels.end(), target) - labels.begin()];
+  state.run_begin =
+      static_cast<int>(std::find(pc_list_sorted.begin(), pc_list_sorted.end(), state.target) - pc_list_sorted.begin());
+  state.run_end = state.run_begin +
+                  static_cast<int>(std::count(pc_list_sorted.begin(), pc_list_sorted.end(), state.target));
+  state.base = state.run_end - state.run_begin - capacity;
+
+  int pawn_b = CountPawnLike<Black>(pc_list_sorted);
+  int pawn_w = CountPawnLike<White>(pc_list_sorted);
+  PiecePositions pieces_log;
+  MaximizeImpl(pc_list_sorted, state, 0, pawn_b, pawn_w, allOneBB<F, R>(), allZeroBB<F, R>(), 0, 0, pieces_log);
+  if (state.best < 0) {
+    return state.best;
+  }
+
+  // Restore the original pieces. Merged pieces have the same effects, so they may be assigned in any order.
+  std::vector<PieceType> originals[PCNum];
+  for (std::size_t i = 0; i < pc_list_sorted.size(); ++i) {
+    originals[pc_list_sorted[i]].push_back(labels[i]);
+  }
+  auto& run_originals = originals[state.target];
+  for (int i = 0; i < capacity; ++i) {
+    run_originals.erase(std::find(run_originals.begin(), run_originals.end(), target));
+  }
+  run_originals.insert(run_originals.end(), state.best, target);
+  std::size_t used[PCNum]{};
+  for (auto& piece : state.witness) {
+    piece.pc = originals[piece.pc][used[piece.pc]++];
+  }
+  Report(Pieces2Sfen<F, R>(state.witness), ans_sfens_);
+  return state.best;
+}
+
+template <int F, int R>
+std::vector<BasicSubproblem<F, R>> BasicSearch<F, R>::Split(const PCVector& pc_list, int depth, bool merge) {
+  if (config_.reverse_search) {
+    throw std::runtime_error("split is not allowed in reversible search");
+  }
+
+  // Every prefix must be enumerated, so the search must not stop at the first placement
+  bool all_placement = config_.all_placement;
+  config_.all_placement = true;
+  split_depth_ = std::min(depth, static_cast<int>(pc_list.size()));
+  merge_pieces_ = merge;
+  RunUnreversible(pc_list);
+  merge_pieces_ = true;
+  split_depth_ = -1;
+  config_.all_placement = all_placement;
+
+  std::vector<Subproblem> subproblems;
+  subproblems.swap(subproblems_);
+  return subproblems;
+}
+
+template <int F, int R>
+int BasicSearch<F, R>::Solve(const Subproblem& subproblem) {
+  const PCVector& pc_list = subproblem.pc_list;
+  int depth = static_cast<int>(subproblem.pieces_log.size());
+  PCVector rest(pc_list.begin() + depth, pc_list.end());
+  labels_ = subproblem.labels;
+  BuildLabelRuns(pc_list);
+
+  int pawn_b = CountPawnLike<Black>(rest);
+  int pawn_w = CountPawnLike<White>(rest);
+  pawns_last_[Black] = IsPawnsLast<Black>(pc_list);
+  pawns_last_[White] = IsPawnsLast<White>(pc_list);
+  BuildAttackRows(pc_list, false);
+  Square last_sq = depth > 0 ? subproblem.pieces_log.back().sq : 0;
+
+  PiecePositions pieces_log(subproblem.pieces_log);
+  return SearchImpl(pc_list, pawn_b, pawn_w, subproblem.no_effect_bb, subproblem.pieces_bb, depth, last_sq, pieces_log,
+                    ans_sfens_);
+}
+
+template <int F, int R>
+EstimateResult BasicSearch<F, R>::Estimate(const PCVector& pc_list, u64 seed) {
+  if (config_.reverse_search) {
+    throw std::runtime_error("estimate is not allowed in reversible search");
+  }
+
+  PCVector pc_list_sorted = PrepareUnreversible(pc_list);
+  int pc_len = static_cast<int>(pc_list_sorted.size());
+  // Every placement of merged pieces is reported once for each assignment of labels
+  double multiplicity = 1;
+  for (const auto& run : label_runs_) {
+    for (int i = run.first; i < run.second; ++i) {
+      multiplicity *= i - run.first + 1;
+      multiplicity /= std::count(labels_.begin() + run.first, labels_.begin() + i + 1, labels_[i]);
+    }
+  }
+  std::mt19937_64 rng(seed);
+  double node_sum = 0;
+  double node_square_sum = 0;
+  double solution_sum = 0;
+  double solution_square_sum = 0;
+  EstimateResult result;
+  // Each probe counts the depths it visits as nodes, so that it is stopped in the same way as the search
+  while (!LimitReached()) {
+    int pawn_b = CountPawnLike<Black>(pc_list_sorted);
+    int pawn_w = CountPawnLike<White>(pc_list_sorted);
+    Bitboard no_effect_bb = allOneBB<F, R>();
+    Bitboard pieces_bb = allZeroBB<F, R>();
+    Square last_sq = 0;
+    // The number of the nodes at the current depth which the probe represents
+    double weight = 1;
+    double nodes = 0;
+    double solutions = 0;
+    for (int depth = 0;; ++depth) {
+      if (depth >= pc_len) {
+        solutions = weight * multiplicity;
+        break;
+      }
+
+      ++node_count_;
+      Bitboard placeable_bb;
+      if (!ExpandNode(pc_list_sorted, pawn_b, pawn_w, no_effect_bb, pieces_bb, depth, last_sq, placeable_bb)) {
+        break;
+      }
+      nodes += weight * placeable_bb.popCount();
+
+      const Bitboard* attack_row = AttackRowOf(depth);
+      Square children[kSquareNum];
+      int child_num = 0;
+      while (placeable_bb.isAny()) {
+        Square sq = PopSquare(placeable_bb);
+        if (!attack_row[sq].andIsAny(pieces_bb)) {
+          children[child_num++] = sq;
+        }
+      }
+      if (child_num == 0) {
+        break;
+      }
+
+      PieceType pc = pc_list_sorted[depth];
+      Square sq = children[rng() % child_num];
+      weight *= child_num;
+      no_effect_bb &= ~attack_row[sq];
+      pieces_bb |= SquareMaskBB<F, R>(sq);
+      pawn_b -= IsPawnLike<Black>(pc);
+      pawn_w -= IsPawnLike<White>(pc);
+      last_sq = sq;
+    }
+
+    ++result.probe_cnt;
+    node_sum += nodes;
+    node_square_sum += nodes * nodes;
+    solution_sum += solutions;
+    solution_square_sum += solutions * solutions;
   }
 
+  if (result.probe_cnt > 0) {
+    // 1.96 is the 97.5th percentile of the standard normal distribution
+    double n = static_cast<double>(result.probe_cnt);
+    auto error = [n](double sum, double square_sum) {
+      return n > 1 ? 1.96 * std::sqrt(std::max(0.0, (square_sum - sum * sum / n) / (n - 1)) / n) : 0.0;
+    };
+    result.nodes = node_sum / n;
+    result.nodes_error = error(node_sum, node_square_sum);
+    result.solutions = solution_sum / n;
+    result.solutions_error = error(solution_sum, solution_square_sum);
+  }
+  return result;
+}
+
+template <int F, int R>
+std::vector<BatchVerdict> BasicSearch<F, R>::RunBatch(const std::vector<PCVector>& pc_lists) {
+  if (config_.reverse_search || config_.all_placement) {
+    throw std::runtime_error("batch is only allowed in unidirectional search for a placement");
+  }
+
+  std::vector<BatchMember> members;
+  std::vector<BatchNode> trie(1);
+  std::size_t max_len = 0;
+  for (const auto& pc_list : pc_lists) {
+    BatchMember member;
+    member.pc_list = PrepareUnreversible(pc_list);
+    SwapBatchMember(member);
+
+    int len = static_cast<int>(member.pc_list.size());
+    for (Color c : {Black, White}) {
+      member.pawn_rest[c].assign(len + 1, 0);
+      for (int depth = len - 1; depth >= 0; --depth) {
+        PieceType pc = member.pc_list[depth];
+        member.pawn_rest[c][depth] =
+            member.pawn_rest[c][depth + 1] + (c == Black ? IsPawnLike<Black>(pc) : IsPawnLike<White>(pc));
+      }
+    }
+
+    int node = 0;
+    for (auto pc : member.pc_list) {
+      auto itr = std::find_if(trie[node].children.begin(), trie[node].children.end(),
+                              [&](int child) { return trie[child].pc == pc; });
+      if (itr != trie[node].children.end()) {
+        node = *itr;
+      } else {
+        trie[node].children.push_back(static_cast<int>(trie.size()));
+        node = static_cast<int>(trie.size());
+        trie.push_back({pc, {}});
+      }
+    }
+    max_len = std::max(max_len, member.pc_list.size());
+    members.push_back(std::move(member));
+  }
+
+  // Placements are returned in the verdicts instead of being passed to the callback
+  auto on_solution = std::move(config_.on_solution);
+  config_.on_solution = nullptr;
+  std::vector<BatchVerdict> verdicts(members.size());
+  batch_alive_.assign(max_len + 2, {});
+  for (std::size_t m = 0; m < members.size(); ++m) {
+    batch_alive_[0].push_back(static_cast<int>(m));
+  }
+
+  PiecePositions pieces_log;
+  BatchImpl(trie, members, 0, allOneBB<F, R>(), allZeroBB<F, R>(), 0, 0, pieces_log, verdicts);
+  for (auto& verdict : verdicts) {
+    if (verdict.status == kBatchUnknown && !interrupted_) {
+      verdict.status = kBatchUnsolvable;
+    }
+  }
+  batch_alive_.clear();
+  config_.on_solution = std::move(on_solution);
+  return verdicts;
+}
+
+template <int F, int R>
+void BasicSearch<F, R>::SwapBatchMember(BatchMember& member) {
+  labels_.swap(member.labels);
+  label_runs_.swap(member.label_runs);
+  std::swap(pawns_last_, member.pawns_last);
+  attack_rows_.swap(member.attack_rows);
+  attack_row_index_.swap(member.attack_row_index);
+}
+
+template <int F, int R>
+void BasicSearch<F, R>::BatchImpl(const std::vector<BatchNode>& trie,
+                                  std::vector<BatchMember>& members,
+                                  int node,
+                                  const Bitboard& no_effect_bb,
+                                  const Bitboard& pieces_bb,
+                                  int depth,
+                                  Square last_sq,
+                                  PiecePositions& pieces_log,
+                                  std::vector<BatchVerdict>& verdicts) {
+  auto is_solved = [&](int m) { return verdicts[m].status == kBatchSolved; };
+  auto& alive = batch_alive_[depth];
+  for (int m : alive) {
+    const auto& member = members[m];
+    if (static_cast<int>(member.pc_list.size()) == depth) {
+      PiecePositions pieces(pieces_log);
+      for (std::size_t i = 0; i < pieces.size() && !member.labels.empty(); ++i) {
+        pieces[i].pc = member.labels[i];
+      }
+      verdicts[m] = {kBatchSolved, Pieces2Sfen<F, R>(pieces)};
+    }
+  }
+  alive.erase(std::remove_if(alive.begin(), alive.end(), is_solved), alive.end());
+
+  // `batch_alive_` is never resized during the search, so `next_alive` stays valid in the deeper calls
+  auto& next_alive = batch_alive_[depth + 1];
+  for (int child : trie[node].children) {
+    PieceType pc = trie[child].pc;
+    Bitboard placeable_bb = no_effect_bb;
+    Bitboard greater_bb = no_effect_bb;
+    if (depth > 0 && trie[node].pc == pc) {
+      placeable_bb &= GreaterMask<F, R>(last_sq);
+      greater_bb = placeable_bb;
+    }
+
+    // The same judge as `ExpandNode` for each member with its own rest of pieces
+    next_alive.clear();
+    for (int m : alive) {
+      const auto& member = members[m];
+      if (is_solved(m) || member.pc_list[depth] != pc) {
+        continue;
+      }
+
+      int rest_len = static_cast<int>(member.pc_list.size()) - depth;
+      int pawn_b = member.pawn_rest[Black][depth];
+      int pawn_w = member.pawn_rest[White][depth];
+      const Bitboard& pawn_allowed_b = pc == BlackPawn && member.pawns_last[Black] ? greater_bb : no_effect_bb;
+      const Bitboard& pawn_allowed_w = pc == WhitePawn && member.pawns_last[White] ? greater_bb : no_effect_bb;
+      if (JudgeColumns(kColumnBlack, no_effect_bb, pieces_bb, pawn_allowed_b, pawn_b, rest_len - pawn_b) &&
+          JudgeColumns(kColumnWhite, no_effect_bb, pieces_bb, pawn_allowed_w, pawn_w, rest_len - pawn_w)) {
+        next_alive.push_back(m);
+      }
+    }
+
+    if (next_alive.size() == 1) {
+      // The rest is the same as the search of the set alone
+      int m = next_alive[0];
+      auto& member = members[m];
+      std::vector<std::string> ans;
+      SwapBatchMember(member);
+      SearchImpl(member.pc_list, member.pawn_rest[Black][depth], member.pawn_rest[White][depth], no_effect_bb,
+                 pieces_bb, depth, last_sq, pieces_log, ans);
+      SwapBatchMember(member);
+      if (!ans.empty()) {
+        verdicts[m] = {kBatchSolved, std::move(ans[0])};
+      }
+      if (interrupted_) {
+        return;
+      }
+      continue;
+    }
+
+    // The deeper calls remove solved members from `next_alive`, so the loop ends when every member is solved
+    while (placeable_bb.isAny() && !next_alive.empty()) {
+      Square sq = PopSquare(placeable_bb);
+      ++node_count_;
+      if (LimitReached()) {
+        return;
+      }
+
+      Bitboard attack = AttackBB<F, R>(pc, sq);
+      if (!attack.andIsAny(pieces_bb)) {
+        pieces_log.push_back({pc, sq});
+        BatchImpl(trie, members, child, no_effect_bb & ~attack, pieces_bb | SquareMaskBB<F, R>(sq), depth + 1, sq,
+                  pieces_log, verdicts);
+        pieces_log.pop_back();
+      }
+    }
+  }
+  alive.erase(std::remove_if(alive.begin(), alive.end(), is_solved), alive.end());
+}
+
+template <int F, int R>
+inline bool BasicSearch<F, R>::ExpandNode(const PCVector& pc_list,
+                                          int pawn_b,
+                                          int pawn_w,
+                                          const Bitboard& no_effect_bb,
+                                          const Bitboard& pieces_bb,
+                                          int depth,
+                                          Square last_sq,
+                                          Bitboard& placeable_bb,
+                                          int optional) const {
+  int pc_len = static_cast<int>(pc_list.size()) - optional;
   PieceType pc = pc_list[depth];
-  Bitboard pawn_allowed_b = PawnPlaceable<Black>(no_effect_bb, pieces_bb);
-  Bitboard pawn_allowed_w = PawnPlaceable<White>(no_effect_bb, pieces_bb);
-  Bitboard placeable_bb = no_effect_bb;
+  Bitboard pawn_allowed_b = no_effect_bb;
+  Bitboard pawn_allowed_w = no_effect_bb;
+  placeable_bb = no_effect_bb;
   // In order to avoid duplicate search, if a placed piece is the same as the previous one, it can be places on squares
   // that is greater than previous one.
   if (depth > 0 && pc_list[depth - 1] == pc) {
-    placeable_bb &= GreaterMask(last_sq);
-    if (pc == BlackPawn) {
-      pawn_allowed_b &= GreaterMask(last_sq);
-    } else if (pc == WhitePawn) {
-      pawn_allowed_w &= GreaterMask(last_sq);
+    placeable_bb &= GreaterMask<F, R>(last_sq);
+    if (pc == BlackPawn && pawns_last_[Black]) {
+      pawn_allowed_b &= GreaterMask<F, R>(last_sq);
+    } else if (pc == WhitePawn && pawns_last_[White]) {
+      pawn_allowed_w &= GreaterMask<F, R>(last_sq);
     }
   }
 
   int stone_b = pc_len - depth - pawn_b;
   int stonw_w = pc_len - depth - pawn_w;
   // Purning by inferier pieces method
-  if (!JudgePlaceable<Black>(no_effect_bb, pawn_b, stone_b, pawn_allowed_b) ||
-      !JudgePlaceable<White>(no_effect_bb, pawn_w, stonw_w, pawn_allowed_w)) {
+  return JudgeColumns(kColumnBlack, no_effect_bb, pieces_bb, pawn_allowed_b, pawn_b, stone_b) &&
+         JudgeColumns(kColumnWhite, no_effect_bb, pieces_bb, pawn_allowed_w, pawn_w, stonw_w);
+}
+
+template <int F, int R>
+void BasicSearch<F, R>::CaptureJudges(const PCVector& pc_list,
+                                      int pawn_b,
+                                      int pawn_w,
+                                      const Bitboard& no_effect_bb,
+                                      const Bitboard& pieces_bb,
+                                      int depth,
+                                      Square last_sq) {
+  int pc_len = static_cast<int>(pc_list.size());
+  PieceType pc = pc_list[depth];
+  JudgeInput black{kColumnBlack, no_effect_bb, pieces_bb, no_effect_bb, pawn_b, pc_len - depth - pawn_b};
+  JudgeInput white{kColumnWhite, no_effect_bb, pieces_bb, no_effect_bb, pawn_w, pc_len - depth - pawn_w};
+  if (depth > 0 && pc_list[depth - 1] == pc) {
+    if (pc == BlackPawn && pawns_last_[Black]) {
+      black.pawn_allowed &= GreaterMask<F, R>(last_sq);
+    } else if (pc == WhitePawn && pawns_last_[White]) {
+      white.pawn_allowed &= GreaterMask<F, R>(last_sq);
+    }
+  }
+  CaptureJudge(black);
+  CaptureJudge(white);
+}
+
+template <int F, int R>
+int BasicSearch<F, R>::SearchImpl(const PCVector& pc_list,
+                                  int pawn_b,
+                                  int pawn_w,
+                                  Bitboard no_effect_bb,
+                                  Bitboard pieces_bb,
+                                  int depth,
+                                  Square last_sq,
+                                  PiecePositions& pieces_log,
+                                  std::vector<std::string>& ans) {
+  int pc_len = static_cast<int>(pc_list.size());
+  if (depth > static_cast<int>(deepest_.size())) {
+    // Remember the partial placement in case the search is interrupted
+    deepest_ = pieces_log;
+  }
+
+  if (depth >= pc_len) {
+    // Found a placement
+    return Measure(kPerfPhaseReport, [&] {
+      return config_.stats ? RecordStats(pieces_log, no_effect_bb) : ReportPlacement(pieces_log, ans);
+    });
+  }
+
+  PieceType pc = pc_list[depth];
+  Bitboard placeable_bb;
+  if (config_.on_judge) {
+    CaptureJudges(pc_list, pawn_b, pawn_w, no_effect_bb, pieces_bb, depth, last_sq);
+  }
+  if (!Measure(kPerfPhaseJudge, [&] {
+        return ExpandNode(pc_list, pawn_b, pawn_w, no_effect_bb, pieces_bb, depth, last_sq, placeable_bb);
+      })) {
     return 0;
   }
 
+  if (depth == split_depth_) {
+    subproblems_.push_back({pc_list, pieces_log, no_effect_bb, pieces_bb, labels_});
+    return 0;
+  }
+
+  const Bitboard* attack_row = AttackRowOf(depth);
+  if (config_.group_runs && !config_.score_order && split_depth_ < 0 && depth + 1 < pc_len &&
+      pc_list[depth + 1] == pc && (depth == 0 || pc_list[depth - 1] != pc)) {
+    int run_end = depth + 2;
+    while (run_end < pc_len && pc_list[run_end] == pc) {
+      ++run_end;
+    }
+
+    // The squares where the piece effects a placed piece never become available in the run
+    Bitboard candidate_bb = allZeroBB<F, R>();
+    while (placeable_bb.isAny()) {
+      Square sq = PopSquare(placeable_bb);
+      if (!attack_row[sq].andIsAny(pieces_bb)) {
+        candidate_bb |= SquareMaskBB<F, R>(sq);
+      }
+    }
+    return PlaceRun(pc_list, pawn_b, pawn_w, no_effect_bb, pieces_bb, candidate_bb, depth, run_end, pieces_log, ans);
+  }
+
+  // Identical pieces must be placed in ascending order of squares, so only the last of them is ordered by score
+  Square order_buf[kSquareNum];
+  const Square* order = nullptr;
+  if (config_.score_order && (depth + 1 >= pc_len || pc_list[depth + 1] != pc)) {
+    order = OrderSquares(pc, placeable_bb, no_effect_bb, order_buf);
+  }
+  const Bitboard* next_attack_row = depth + 1 < pc_len ? AttackRowOf(depth + 1) : attack_row;
   int found_cnt = 0;
   while (placeable_bb.isAny()) {
-    Square sq = placeable_bb.firstOneFromSQ11();
+    Square sq = PopSquare(placeable_bb, order);
     ++node_count_;
     // Check the limit of nodes
-    if (config_.node_limit != Unlimit && node_count_ >= config_.node_limit) {
-      return 0;
+    if (LimitReached()) {
+      return found_cnt;
     }
 
-    Bitboard attack = AttackBB(pc, sq);
+    Bitboard attack = attack_row[sq];
     if (!attack.andIsAny(pieces_bb)) {
       // Placeable pc at sq
       pieces_log.push_back({pc, sq});
 
+      // The next depth tries the first empty square first, so load its effects while the next node is judged
+      Bitboard next_no_effect_bb = no_effect_bb & ~attack;
+      if (next_no_effect_bb.isAny()) {
+        _mm_prefetch(reinterpret_cast<const char*>(&next_attack_row[next_no_effect_bb.constFirstOneFromSQ11()]),
+                     _MM_HINT_T0);
+      }
+
       // Update #(pawn) and go to next depth
       int new_pawn_b = pawn_b - IsPawnLike<Black>(pc);
       int new_pawn_w = pawn_w - IsPawnLike<White>(pc);
-      found_cnt += SearchImpl(pc_list, new_pawn_b, new_pawn_w, no_effect_bb & (~attack), pieces_bb | SquareMaskBB(sq),
+      found_cnt += SearchImpl(pc_list, new_pawn_b, new_pawn_w, next_no_effect_bb, pieces_bb | SquareMaskBB<F, R>(sq),
                               depth + 1, sq, pieces_log, ans);
       pieces_log.pop_back();
 
@@ -455,32 +1047,85 @@ int Search::SearchImpl(const PCVector& pc_list,
   return found_cnt;
 }
 
-int Search::SearchImplReversiblePawn(const PCVector& pc_list,
-                                     int pawn,
-                                     int stone,
-                                     int lance,
-                                     Bitboard no_effect_bb,
-                                     Bitboard pieces_bb,
-                                     int depth,
-                                     Square last_sq,
-                                     PiecePositions& pieces_log,
-                                     std::vector<std::string>& ans) {
+template <int F, int R>
+int BasicSearch<F, R>::PlaceRun(const PCVector& pc_list,
+                                int pawn_b,
+                                int pawn_w,
+                                Bitboard no_effect_bb,
+                                Bitboard pieces_bb,
+                                Bitboard candidate_bb,
+                                int depth,
+                                int run_end,
+                                PiecePositions& pieces_log,
+                                std::vector<std::string>& ans) {
+  if (depth == run_end) {
+    return SearchImpl(pc_list, pawn_b, pawn_w, no_effect_bb, pieces_bb, depth, pieces_log.back().sq, pieces_log, ans);
+  }
+
+  // The first piece of the run is already judged by `SearchImpl`, and it may be the first piece of `pc_list`
+  PieceType pc = pc_list[depth];
+  Bitboard unused_bb;
+  if (depth > 0 && pc_list[depth - 1] == pc &&
+      !ExpandNode(pc_list, pawn_b, pawn_w, no_effect_bb, pieces_bb, depth, pieces_log.back().sq, unused_bb)) {
+    return 0;
+  }
+
+  // The squares where a piece effects `sq` are those effected by the piece of the other color at `sq`
+  PieceType effected_by = IsSymmetry(Pc2Pt(pc)) ? pc : Reverse(pc);
+  const Bitboard* attack_row = AttackRowOf(depth);
+  int new_pawn_b = pawn_b - IsPawnLike<Black>(pc);
+  int new_pawn_w = pawn_w - IsPawnLike<White>(pc);
+  int found_cnt = 0;
+  while (candidate_bb.popCount() >= run_end - depth) {
+    // Once `sq` is skipped, it is never used in this branch
+    Square sq = candidate_bb.firstOneFromSQ11();
+    ++node_count_;
+    if (LimitReached()) {
+      return found_cnt;
+    }
+
+    Bitboard attack = attack_row[sq];
+    pieces_log.push_back({pc, sq});
+    found_cnt += PlaceRun(pc_list, new_pawn_b, new_pawn_w, no_effect_bb & ~attack, pieces_bb | SquareMaskBB<F, R>(sq),
+                          candidate_bb & ~attack & ~AttackBB<F, R>(effected_by, sq), depth + 1, run_end, pieces_log,
+                          ans);
+    pieces_log.pop_back();
+
+    if (!config_.all_placement && found_cnt > 0) {
+      break;
+    }
+  }
+  return found_cnt;
+}
+
+template <int F, int R>
+int BasicSearch<F, R>::SearchImplReversiblePawn(const PCVector& pc_list,
+                                                int pawn,
+                                                int stone,
+                                                int lance,
+                                                int flip_up,
+                                                Bitboard no_effect_bb,
+                                                Bitboard pieces_bb,
+                                                int depth,
+                                                Square last_sq,
+                                                PiecePositions& pieces_log,
+                                                std::vector<std::string>& ans) {
   int pc_len = static_cast<int>(pc_list.size());
+  if (depth > static_cast<int>(deepest_.size())) {
+    // Remember the partial placement in case the search is interrupted
+    deepest_ = pieces_log;
+  }
 
   if (depth >= pc_len) {
-    Bitboard pawn_b, pawn_w;
-    // judge if remain pawns and stones are placeable
-    if (GetNonDirectionalPlacement(no_effect_bb, pawn, stone, pieces_bb, pawn_b, pawn_w)) {
-      if ((pawn_b & Edge2BB(Black)).popCount() + (pawn_w & Edge2BB(White)).popCount() < lance) {
-        return 0;
-      }
-      auto stone_bb = no_effect_bb & ~pawn_b & ~pawn_w;
-
+    Bitboard pawn_b, pawn_w, stone_bb;
+    // judge if remain pawns and stones are placeable. Lances replace the pawns with no piece in front of them.
+    if (GetColumnPlacement(no_effect_bb, pieces_bb, pawn, stone, lance, pawn_b, pawn_w, stone_bb)) {
       PiecePositions pieces_ans(pieces_log);
       // convert pawn_bb, pawn_v_bb to pieces_log entry
+      Bitboard lance_bb = LanceablePawns(pawn_b, pawn_w, pieces_bb | pawn_b | pawn_w | stone_bb);
       while (pawn_b.isAny()) {
         Square sq = pawn_b.firstOneFromSQ11();
-        if (lance > 0 && GetRank(sq) <= 1) {
+        if (lance > 0 && lance_bb.isSet(sq)) {
           pieces_ans.push_back({BlackLance, sq});
           lance--;
         } else {
@@ -489,7 +1134,7 @@ int Search::SearchImplReversiblePawn(const PCVector& pc_list,
       }
       while (pawn_w.isAny()) {
         Square sq = pawn_w.firstOneFromSQ11();
-        if (lance > 0 && GetRank(sq) >= 7) {
+        if (lance > 0 && lance_bb.isSet(sq)) {
           pieces_ans.push_back({WhiteLance, sq});
           lance--;
         } else {
@@ -497,53 +1142,86 @@ int Search::SearchImplReversiblePawn(const PCVector& pc_list,
         }
       }
       while (stone_bb.isAny()) {
-        Square sq = stone_bb.firstOneFromSQ11();
-        if (stone > 0) {
-          pieces_ans.push_back({Stone, sq});
-        }
+        pieces_ans.push_back({Stone, stone_bb.firstOneFromSQ11()});
       }
 
-      ans.push_back(Pieces2Sfen(pieces_ans));
-      return 1;
+      return Measure(kPerfPhaseReport, [&] {
+        ans.push_back(Pieces2Sfen<F, R>(pieces_ans));
+        return 1;
+      });
     } else {
       return 0;
     }
   }
 
+  // pawn-stone purning, which also keeps enough squares on the edge ranks for lances
+  if (config_.on_judge) {
+    CaptureJudge({kColumnMixed, no_effect_bb, pieces_bb, no_effect_bb, pawn, stone, lance});
+  }
+  if (!Measure(kPerfPhaseJudge,
+               [&] { return JudgeColumns(kColumnMixed, no_effect_bb, pieces_bb, no_effect_bb, pawn, stone, lance); })) {
+    return 0;
+  }
+
+  // Identical pieces are placed as all upward ones in ascending order of squares, and then all downward ones in
+  // ascending order of squares. Each placement is searched only once in this way.
   PieceType pc = pc_list[depth];
-  Bitboard placeable_bb = no_effect_bb;
+  PieceType rev_pc = Reverse(pc);
+  bool is_flip_pt = pc == flip_pt_;
+  Bitboard up_bb = no_effect_bb;
+  Bitboard down_bb = no_effect_bb;
+  if (IsSymmetry(pc) || (is_flip_pt && flip_up < flip_need_)) {
+    // For `flip_pt_`, the downward direction is allowed only after enough pieces face upward
+    down_bb = allZeroBB<F, R>();
+  }
   if (depth > 0 && pc_list[depth - 1] == pc) {
-    placeable_bb &= GreaterMask(last_sq);
+    if (pieces_log.back().pc == pc) {
+      up_bb &= GreaterMask<F, R>(last_sq);
+    } else {
+      up_bb = allZeroBB<F, R>();
+      down_bb &= GreaterMask<F, R>(last_sq);
+    }
   }
 
-  // pawn-stone purning
-  if (!JudgeNonDirectionalPlacement(no_effect_bb, pawn, stone, pieces_bb)) {
-    return 0;
+  int new_pawn = pawn - (IsPawnLike<Black>(pc) || IsPawnLike<White>(pc));
+  int new_stone = stone - !(IsPawnLike<Black>(pc) || IsPawnLike<White>(pc));
+  PieceType dir_pcs[2] = {pc, rev_pc};
+  if (reverse_first_[depth]) {
+    std::swap(dir_pcs[0], dir_pcs[1]);
   }
 
+  // Try every square in the preferred direction first, so that the search follows one direction of pieces for long
   int found_cnt = 0;
-  while (placeable_bb.isAny()) {
-    // check limit of nodes
-    ++node_count_;
-    if (config_.node_limit != Unlimit && node_count_ >= config_.node_limit) {
-      return 0;
+  for (PieceType dir_pc : dir_pcs) {
+    Bitboard placeable_bb = dir_pc == pc ? up_bb : down_bb;
+    const Bitboard* attack_row = AttackRowOf(depth, dir_pc != pc);
+    Square order_buf[kSquareNum];
+    const Square* order = nullptr;
+    if (config_.score_order && (depth + 1 >= pc_len || pc_list[depth + 1] != pc)) {
+      order = OrderSquares(dir_pc, placeable_bb, no_effect_bb, order_buf);
     }
+    while (placeable_bb.isAny()) {
+      // check limit of nodes
+      ++node_count_;
+      if (LimitReached()) {
+        return found_cnt;
+      }
 
-    Square sq = placeable_bb.firstOneFromSQ11();
-    Bitboard attack = AttackBB(pc, sq);
-    if (!attack.andIsAny(pieces_bb)) {
-      // placeable pc at sq
-      pieces_log.push_back({pc, sq});
+      Square sq = PopSquare(placeable_bb, order);
+      Bitboard attack = attack_row[sq];
+      if (!attack.andIsAny(pieces_bb)) {
+        // placeable pc at sq
+        pieces_log.push_back({dir_pc, sq});
 
-      int new_pawn = pawn - (IsPawnLike<Black>(pc) || IsPawnLike<White>(pc));
-      int new_stone = stone - !(IsPawnLike<Black>(pc) || IsPawnLike<White>(pc));
-      found_cnt += SearchImplReversiblePawn(pc_list, new_pawn, new_stone, lance, no_effect_bb & (~attack),
-                                            pieces_bb | SquareMaskBB(sq), depth + 1, sq, pieces_log, ans);
+        int new_flip_up = flip_up + (is_flip_pt && dir_pc == pc);
+        found_cnt += SearchImplReversiblePawn(pc_list, new_pawn, new_stone, lance, new_flip_up, no_effect_bb & (~attack),
+                                              pieces_bb | SquareMaskBB<F, R>(sq), depth + 1, sq, pieces_log, ans);
 
-      pieces_log.pop_back();
+        pieces_log.pop_back();
 
-      if (!config_.all_placement && found_cnt > 0) {
-        return found_cnt;
+        if (!config_.all_placement && found_cnt > 0) {
+          return found_cnt;
+        }
       }
     }
   }
@@ -551,4 +1229,99 @@ int Search::SearchImplReversiblePawn(const PCVector& pc_list,
   return found_cnt;
 }
 
-}  // namespace komori
\ No newline at end of file
+template <int F, int R>
+void BasicSearch<F, R>::MaximizeImpl(const PCVector& pc_list,
+                                     MaximizeState& state,
+                                     int extra,
+                                     int pawn_b,
+                                     int pawn_w,
+                                     Bitboard no_effect_bb,
+                                     Bitboard pieces_bb,
+                                     int depth,
+                                     Square last_sq,
+                                     PiecePositions& pieces_log) {
+  int pc_len = static_cast<int>(pc_list.size());
+  bool in_run = depth >= state.run_begin && depth < state.run_end;
+  if (depth >= state.run_end && extra <= state.best) {
+    // This branch cannot beat the incumbent any more
+    return;
+  }
+
+  if (depth >= pc_len) {
+    // Found a better placement. Warm-start the next bound by adding `target`s to the new incumbent greedily.
+    state.witness = pieces_log;
+    const Bitboard* attack_row = AttackRowOf(state.run_begin);
+    Bitboard extendable_bb = no_effect_bb;
+    while (extendable_bb.isAny()) {
+      Square sq = PopSquare(extendable_bb);
+      if (no_effect_bb.isSet(sq) && !attack_row[sq].andIsAny(pieces_bb)) {
+        state.witness.push_back({state.target, sq});
+        pieces_bb |= SquareMaskBB<F, R>(sq);
+        no_effect_bb &= ~attack_row[sq];
+        ++extra;
+      }
+    }
+    state.best = extra;
+    return;
+  }
+
+  // The run may be closed at `close_depth` to beat the incumbent, and the rest of it is optional. The real problem is
+  // monotone (a placeable set stays placeable when a piece is removed), so only the needed pieces are judged.
+  int close_depth = state.run_begin + state.base + state.best + 1;
+  int optional = 0;
+  if (depth < state.run_end) {
+    if (close_depth > state.run_end) {
+      return;
+    }
+    optional = state.run_end - std::max(depth, close_depth);
+  }
+  int optional_pawn_b = optional * IsPawnLike<Black>(state.target);
+  int optional_pawn_w = optional * IsPawnLike<White>(state.target);
+  Bitboard placeable_bb;
+  if (!Measure(kPerfPhaseJudge, [&] {
+        return ExpandNode(pc_list, pawn_b - optional_pawn_b, pawn_w - optional_pawn_w, no_effect_bb, pieces_bb, depth,
+                          last_sq, placeable_bb, optional);
+      })) {
+    return;
+  }
+
+  PieceType pc = pc_list[depth];
+  const Bitboard* attack_row = AttackRowOf(depth);
+  Square order_buf[kSquareNum];
+  const Square* order = nullptr;
+  if (config_.score_order && (depth + 1 >= pc_len || pc_list[depth + 1] != pc)) {
+    order = OrderSquares(pc, placeable_bb, no_effect_bb, order_buf);
+  }
+  int new_extra = in_run ? depth + 1 - state.run_begin - state.base : extra;
+  while (placeable_bb.isAny()) {
+    Square sq = PopSquare(placeable_bb, order);
+    ++node_count_;
+    // Check the limit of nodes
+    if (LimitReached()) {
+      return;
+    }
+
+    Bitboard attack = attack_row[sq];
+    if (!attack.andIsAny(pieces_bb)) {
+      pieces_log.push_back({pc, sq});
+      int new_pawn_b = pawn_b - IsPawnLike<Black>(pc);
+      int new_pawn_w = pawn_w - IsPawnLike<White>(pc);
+      MaximizeImpl(pc_list, state, new_extra, new_pawn_b, new_pawn_w, no_effect_bb & ~attack,
+                   pieces_bb | SquareMaskBB<F, R>(sq), depth + 1, sq, pieces_log);
+      pieces_log.pop_back();
+    }
+  }
+
+  if (in_run && depth >= close_depth) {
+    // Stop placing `target`s and go on to the rest of `pc_list`
+    int rest = state.run_end - depth;
+    MaximizeImpl(pc_list, state, depth - state.run_begin - state.base,
+                 pawn_b - rest * IsPawnLike<Black>(state.target), pawn_w - rest * IsPawnLike<White>(state.target),
+                 no_effect_bb, pieces_bb, state.run_end, last_sq, pieces_log);
+  }
+}
+
+#define KOMORI_INSTANTIATE(F, R) template class BasicSearch<F, R>;
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
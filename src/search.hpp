@@ -1,12 +1,20 @@
 #ifndef KOMORI_SEARCH_HPP_
 #define KOMORI_SEARCH_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "column_judge.hpp"
+#include "perf_counter.hpp"
 #include "shogi.hpp"
+#include "solution_stats.hpp"
 
 namespace komori {
 using PCVector = std::vector<PieceType>;
@@ -18,31 +26,312 @@ inline void PrintPcvector(const PCVector& pc_vector) {
   std::putchar('\n');
 }
 
+/// A flag to cancel searches from another thread. Copies of a token share the same flag.
+class CancellationToken {
+ public:
+  CancellationToken(void) : cancelled_{std::make_shared<std::atomic<bool>>(false)} {}
+
+  void Cancel(void) const { cancelled_->store(true); }
+  bool IsCancelled(void) const { return cancelled_->load(std::memory_order_relaxed); }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
 struct SearchConfiguration {
   bool reverse_search{false};
   bool all_placement{false};
 
   u64 node_limit{std::numeric_limits<u64>::max()};
+  /// The seed to shuffle the order of pieces (0: the default order)
+  u64 order_seed{0};
+  /**
+   * @brief The values to sort pieces by (see `LoadOrderTable`). Pieces with smaller values are placed first.
+   *
+   * The default table is used if it is empty.
+   */
+  std::vector<int> order_table{};
+  /// Scan squares from SQ99 instead of SQ11
+  bool reverse_scan{false};
+  /// Try squares which effect the fewest empty squares first (ties are broken in the order of `reverse_scan`)
+  bool score_order{false};
+
+  /// The search stops when this token is cancelled
+  CancellationToken cancel_token{};
+  /// The search stops when this time has come
+  std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+  /**
+   * @brief The function called with each placement found
+   *
+   * If it is set, placements are passed to it instead of being stored in `AnsSfens()`. The search stops when it returns
+   * false.
+   */
+  std::function<bool(const std::string&)> on_solution{};
+  /**
+   * @brief Place each run of identical pieces at once in unidirectional search
+   *
+   * The squares of a run are enumerated as sets of squares which do not effect each other, starting from the squares
+   * which neither effect nor are effected by the placed pieces. It is ignored with `score_order`, `Split()` and
+   * `Maximize()`.
+   */
+  bool group_runs{false};
+  /**
+   * @brief Count placements into `BasicSearch::Stats()` instead of reporting them
+   *
+   * It is meant for `all_placement` in unidirectional search. A placement of merged pieces is counted once with the
+   * number of assignments of the original pieces as its weight, instead of being reported for each assignment.
+   */
+  bool stats{false};
+  /// Read hardware counters around the phases of `Run()` (see `BasicSearch::Profile()`)
+  bool perf_counters{false};
+  /**
+   * @brief The function called with the inputs of the judges of pawns and stones in the search
+   *
+   * Only one in `BasicSearch::kJudgeSampleInterval` judges is passed, written by `JudgeInput2String`. The inputs can be
+   * replayed by the benchmark (see `bench/bench.cpp`).
+   */
+  std::function<void(const std::string&)> on_judge{};
+};
+
+/// Get the table which orders pieces by hand-tuned strength
+std::vector<int> DefaultOrderTable(void);
+/**
+ * @brief Load an order table written by `OrderTable2String`
+ *
+ * Each line is a piece and its value (e.g. "P 303"). Empty lines and lines starting with '#' are ignored, and pieces
+ * which are not written keep the default values. It throws `std::runtime_error` if the file is broken.
+ */
+std::vector<int> LoadOrderTable(const std::string& path);
+/// Get a string representing `table`, one piece per line
+std::string OrderTable2String(const std::vector<int>& table);
+
+/**
+ * @brief A subproblem of the search, which is a placement of the first pieces of the sorted piece list
+ *
+ * A subproblem is self-contained, so that it can be solved by another process (or another machine).
+ */
+template <int F, int R>
+struct BasicSubproblem {
+  /// The sorted pieces to be placed (including the already placed ones)
+  PCVector pc_list{};
+  /// The already placed pieces
+  PiecePositions pieces_log{};
+  BasicBitboard<F, R> no_effect_bb{};
+  BasicBitboard<F, R> pieces_bb{};
+  /// The original pieces of `pc_list` if it has merged pieces (see `BasicSearch::Split`), which is empty otherwise
+  PCVector labels{};
+};
+
+/// Get a string representing `subproblem` in a line. It throws `std::runtime_error` if `subproblem` has labels.
+template <int F, int R>
+std::string Subproblem2String(const BasicSubproblem<F, R>& subproblem);
+/// Parse a line written by `Subproblem2String`. It throws `std::runtime_error` if the line is broken.
+template <int F, int R>
+BasicSubproblem<F, R> String2Subproblem(const std::string& line);
+
+/// The result of `BasicSearch::Estimate`
+struct EstimateResult {
+  u64 probe_cnt{0};
+  /// The estimated number of nodes to find all placements
+  double nodes{0};
+  /// The half width of the 95% confidence interval of `nodes`
+  double nodes_error{0};
+  /// The estimated number of placements
+  double solutions{0};
+  /// The half width of the 95% confidence interval of `solutions`
+  double solutions_error{0};
+};
+
+/// The verdict of a piece set in `BasicSearch::RunBatch`
+enum BatchStatus {
+  kBatchUnknown,     ///< The search was stopped before the verdict
+  kBatchSolved,      ///< A placement is found
+  kBatchUnsolvable,  ///< No placement exists
+};
+
+struct BatchVerdict {
+  BatchStatus status{kBatchUnknown};
+  /// The placement found (empty unless `status` is `kBatchSolved`)
+  std::string sfen{};
 };
 
-class Search {
+/// A search engine for the board which has `F` files and `R` ranks
+template <int F, int R>
+class BasicSearch {
  public:
+  using Bitboard = BasicBitboard<F, R>;
+  using Subproblem = BasicSubproblem<F, R>;
+  using JudgeInput = BasicJudgeInput<F, R>;
   static constexpr u64 Unlimit = std::numeric_limits<u64>::max();
 
-  Search(const SearchConfiguration& config);
-  Search(const Search&) = delete;
-  Search(Search&&) = delete;
-  Search& operator=(const Search&) = delete;
-  Search& operator=(Search&&) = delete;
-  ~Search(void) = default;
+  BasicSearch(const SearchConfiguration& config);
+  BasicSearch(const BasicSearch&) = delete;
+  BasicSearch(BasicSearch&&) = delete;
+  BasicSearch& operator=(const BasicSearch&) = delete;
+  BasicSearch& operator=(BasicSearch&&) = delete;
+  ~BasicSearch(void) = default;
 
   int Run(const PCVector& pc_list);
+  /**
+   * @brief Find the maximum number of `target` which can be placed together with `pc_list`
+   *
+   * @return The maximum number of `target`, or -1 if `pc_list` itself is not placeable. The witness placement is
+   * stored in `AnsSfens()`.
+   */
+  int Maximize(const PCVector& pc_list, PieceType target);
+  /**
+   * @brief Split the search of `pc_list` into subproblems each of which has `depth` pieces placed
+   *
+   * Subproblems are listed in the order of the search. If `merge` is set, pieces with the same effects are merged as
+   * `Run()` does, so that solving the subproblems in order reports placements in the same order as `Run()`. Such
+   * subproblems keep the original pieces in `labels` and cannot be written by `Subproblem2String`.
+   */
+  std::vector<Subproblem> Split(const PCVector& pc_list, int depth, bool merge = false);
+  /// Continue the search from `subproblem`
+  int Solve(const Subproblem& subproblem);
+  /**
+   * @brief Estimate the size of the search tree of `pc_list` with all placements by Knuth's estimator
+   *
+   * Each probe goes down the tree from the root choosing one child at random, and the product of the numbers of
+   * children is an unbiased estimate of the number of nodes at each depth. Probes are repeated until `deadline`,
+   * `cancel_token` or `Stop()`. The estimate is heavy-tailed, so the confidence interval is reliable only with many
+   * probes.
+   */
+  EstimateResult Estimate(const PCVector& pc_list, u64 seed);
+  /**
+   * @brief Find a placement of each piece set of `pc_lists` in one search over the prefixes they share
+   *
+   * The sorted piece lists are put into a trie, and the pieces of a common prefix are placed once for every set under
+   * it. Each set is judged with its own rest of pieces at every node, and a branch ends as soon as every set under it
+   * is solved or pruned. A branch with only one set left is searched in the same way as `Run()`, so `score_order`
+   * and `group_runs` apply only there. The limits of `config_` apply to the whole batch.
+   *
+   * It throws `std::runtime_error` in reversible search or with `all_placement`.
+   */
+  std::vector<BatchVerdict> RunBatch(const std::vector<PCVector>& pc_lists);
   const std::vector<std::string>& AnsSfens(void) const { return ans_sfens_; }
+  /**
+   * @brief The partial placement which has the most pieces among those found in the last search
+   *
+   * In reversible search, it contains neither pawns nor stones because they are placed at once at the end.
+   */
+  const PiecePositions& DeepestPlacement(void) const { return deepest_; }
+  /// Judge if the last search was stopped by `node_limit`, `deadline`, `cancel_token` or `Stop()`
+  bool NodeLimitReached(void) const { return interrupted_; }
+  /// Stop the running search (thread-safe)
+  void Stop(void) { stop_.store(true); }
+  u64 NodeCount(void) const { return node_count_; }
+  /// The hardware counters of the last `Run()` if `perf_counters` is set. No event is available otherwise.
+  const PerfProfile& Profile(void) const { return perf_profile_; }
+  /// The aggregates of the placements found by every search of the object if `config_.stats` is set
+  const SolutionStats& Stats(void) const { return stats_; }
+  const SearchConfiguration& Config(void) const { return config_; }
 
  private:
+  /// The incumbent of branch-and-bound search in `Maximize`
+  struct MaximizeState {
+    /// The piece which `target` is merged into
+    PieceType target{Stone};
+    /// The run of `target` in the sorted pieces, which are [`run_begin`, `run_end`)
+    int run_begin{0};
+    int run_end{0};
+    /// The number of pieces of the run which are not extra `target`s
+    int base{0};
+    /// The maximum number of extra `target`s found so far
+    int best{-1};
+    PiecePositions witness{};
+  };
+
+  /// Judge if the search must stop now. The slow checks in `Poll()` run only once in `kPollInterval` nodes.
+  bool LimitReached(void) { return node_count_ >= next_poll_ && Poll(); }
+  bool Poll(void);
+  /**
+   * @brief Call `func` and return its result. Once in `kPerfSampleInterval` calls, the hardware counters around it are
+   * added to `phase` of `perf_profile_`.
+   */
+  template <typename Func>
+  auto Measure(PerfPhase phase, Func&& func) {
+    if (perf_counters_ == nullptr || perf_profile_.calls[phase]++ % kPerfSampleInterval != 0) {
+      return func();
+    }
+    PerfValues begin = perf_counters_->Read();
+    auto result = func();
+    perf_profile_.Add(phase, begin, perf_counters_->Read());
+    return result;
+  }
+  /// Pass `input` to `config_.on_judge` once in `kJudgeSampleInterval` calls
+  void CaptureJudge(const JudgeInput& input);
+  /// Pass `sfen` to `config_.on_solution`, or store it in `ans` if the callback is not set
+  void Report(std::string sfen, std::vector<std::string>& ans);
+  /**
+   * @brief Report the placement `pieces_log` with the original pieces in `labels_`
+   *
+   * If `config_.all_placement` is set, every distinct assignment of the labels to the squares of each run is reported.
+   *
+   * @return The number of reported placements
+   */
+  int ReportPlacement(const PiecePositions& pieces_log, std::vector<std::string>& ans);
+  /**
+   * @brief Add the placement `pieces_log` with the original pieces in `labels_` to `stats_`
+   *
+   * @return The number of placements which `pieces_log` stands for
+   */
+  int RecordStats(const PiecePositions& pieces_log, const Bitboard& no_effect_bb);
+  /// Pop the next square to try from `bb` in the order of `config_.reverse_scan`
+  Square PopSquare(Bitboard& bb) const { return config_.reverse_scan ? bb.lastOneFromSQ99() : bb.firstOneFromSQ11(); }
+  /// Pop the next square to try. If `order` is set, the square is taken from it instead of the order of squares.
+  Square PopSquare(Bitboard& bb, const Square*& order) const {
+    if (order == nullptr) {
+      return PopSquare(bb);
+    }
+    Square sq = *order++;
+    bb.clearBit(sq);
+    return sq;
+  }
+  /// Sort `candidate_bb` in the order of `config_.score_order` into `order`, and return `order`
+  const Square* OrderSquares(PieceType pc, Bitboard candidate_bb, const Bitboard& no_effect_bb, Square* order) const;
+
+  /**
+   * @brief Sort `pc_list` and prepare the tables for `SearchImpl`
+   *
+   * Pieces whose effects are the same (e.g. Gold and ProSilver) are replaced by one of them and searched as a run of
+   * identical pieces. The original pieces are kept in `labels_`.
+   */
+  PCVector PrepareUnreversible(const PCVector& pc_list);
   int RunUnreversible(const PCVector& pc_list);
   int RunReversible(const PCVector& pc_list);
+  /// Set `label_runs_` for `labels_` and `pc_list`, and clear `labels_` if they have no merged pieces
+  void BuildLabelRuns(const PCVector& pc_list);
 
+  /**
+   * @brief Get the squares to try the piece at `depth` of `SearchImpl` into `placeable_bb`
+   *
+   * `optional` pieces of the rest need not be placed, and `pawn_b` and `pawn_w` do not count them.
+   *
+   * @return False if the rest of the pieces cannot be placed
+   */
+  bool ExpandNode(const PCVector& pc_list,
+                  int pawn_b,
+                  int pawn_w,
+                  const Bitboard& no_effect_bb,
+                  const Bitboard& pieces_bb,
+                  int depth,
+                  Square last_sq,
+                  Bitboard& placeable_bb,
+                  int optional = 0) const;
+  /**
+   * @brief Capture the inputs of the judges in `ExpandNode` with the same arguments
+   *
+   * The inputs are built in the same way as `ExpandNode` does. It is not called in `ExpandNode` because a branch there
+   * slows the search down.
+   */
+  void CaptureJudges(const PCVector& pc_list,
+                     int pawn_b,
+                     int pawn_w,
+                     const Bitboard& no_effect_bb,
+                     const Bitboard& pieces_bb,
+                     int depth,
+                     Square last_sq);
   int SearchImpl(const PCVector& pc_list,
                  int pawn_b,
                  int pawn_v,
@@ -53,10 +342,29 @@ class Search {
                  PiecePositions& pieces_log,
                  std::vector<std::string>& ans);
 
+  /**
+   * @brief Place the identical pieces at [`depth`, `run_end`) on `candidate_bb` and continue `SearchImpl`
+   *
+   * No piece may effect nor be effected by the others, and every square in `candidate_bb` is neither effected nor
+   * effects the placed pieces. Subsets are enumerated by branching on the first candidate, and a branch is cut as soon
+   * as the candidates are fewer than the rest of the run.
+   */
+  int PlaceRun(const PCVector& pc_list,
+               int pawn_b,
+               int pawn_w,
+               Bitboard no_effect_bb,
+               Bitboard pieces_bb,
+               Bitboard candidate_bb,
+               int depth,
+               int run_end,
+               PiecePositions& pieces_log,
+               std::vector<std::string>& ans);
+
   int SearchImplReversiblePawn(const PCVector& pc_list,
                                int pawn,
                                int stone,
                                int lance,
+                               int flip_up,
                                Bitboard no_control,
                                Bitboard pieces_bb,
                                int depth,
@@ -64,10 +372,128 @@ class Search {
                                PiecePositions& pieces_log,
                                std::vector<std::string>& ans);
 
+  /**
+   * @brief Search `pc_list` in the same way as `SearchImpl`, where the run of `state.target` may be closed early
+   *
+   * The run is closed once it has more extra `target`s than `state.best`, and the extra `target`s after it are given
+   * up. `extra` is the number of extra `target`s placed, which is used after the run.
+   */
+  void MaximizeImpl(const PCVector& pc_list,
+                    MaximizeState& state,
+                    int extra,
+                    int pawn_b,
+                    int pawn_w,
+                    Bitboard no_effect_bb,
+                    Bitboard pieces_bb,
+                    int depth,
+                    Square last_sq,
+                    PiecePositions& pieces_log);
+
+  static constexpr u64 kPollInterval = 4096;
+  /// Reading counters takes a few system calls, so only a part of frequent phases is measured
+  static constexpr u64 kPerfSampleInterval = 1024;
+  /// The judges are too many to capture all of them
+  static constexpr u64 kJudgeSampleInterval = 1024;
+  static constexpr int kSquareNum = Board<F, R>::kSquareNum;
+
+  /// The effects of a piece from every square, aligned to cache lines
+  struct alignas(64) AttackRow {
+    Bitboard attack[kSquareNum];
+  };
+
+  /**
+   * @brief Copy the effects of the pieces in `pc_list` into `attack_rows_`
+   *
+   * Consecutive identical pieces share a row. If `reversible` is set, the row of the reversed piece follows each row.
+   */
+  void BuildAttackRows(const PCVector& pc_list, bool reversible);
+  /// The effects of the piece at `depth` (or of the reversed one if `reversed` is set)
+  const Bitboard* AttackRowOf(int depth, bool reversed = false) const {
+    return attack_rows_[attack_row_index_[depth] + reversed].attack;
+  }
+
+  /// A piece set of `RunBatch`
+  struct BatchMember {
+    /// The sorted pieces with merged pieces in the same way as `PrepareUnreversible`
+    PCVector pc_list{};
+    /// The number of pawn-like pieces of each color at each depth and after
+    std::vector<int> pawn_rest[ColorNum]{};
+    /// `labels_`, `label_runs_`, `pawns_last_` and the attack rows for `SearchImpl` of the set
+    PCVector labels{};
+    std::vector<std::pair<int, int>> label_runs{};
+    bool pawns_last[ColorNum]{true, true};
+    std::vector<AttackRow> attack_rows{};
+    std::vector<int> attack_row_index{};
+  };
+
+  /// A node of the trie of `RunBatch`, which is a prefix of the sorted piece lists
+  struct BatchNode {
+    /// The last piece of the prefix (`PieceEmpty` at the root)
+    PieceType pc{PieceEmpty};
+    std::vector<int> children{};
+  };
+
+  /// Exchange `labels_`, `label_runs_`, `pawns_last_` and the attack rows with those of `member`
+  void SwapBatchMember(BatchMember& member);
+  /**
+   * @brief Search the subtree of `trie[node]` for the members in `batch_alive_[depth]`, whose first `depth` pieces are
+   * placed in `pieces_log`
+   *
+   * The members which are solved in the subtree are removed from `batch_alive_[depth]`. A branch which has only one
+   * member left is searched by `SearchImpl`.
+   */
+  void BatchImpl(const std::vector<BatchNode>& trie,
+                 std::vector<BatchMember>& members,
+                 int node,
+                 const Bitboard& no_effect_bb,
+                 const Bitboard& pieces_bb,
+                 int depth,
+                 Square last_sq,
+                 PiecePositions& pieces_log,
+                 std::vector<BatchVerdict>& verdicts);
+
   u64 node_count_{0};
+  /// The number of calls of `CaptureJudge()`
+  u64 judge_count_{0};
+  /// The value of `node_count_` when `Poll()` is called next time
+  u64 next_poll_{0};
+  /// True if the search was stopped before it completed
+  bool interrupted_{false};
+  std::atomic<bool> stop_{false};
   std::vector<std::string> ans_sfens_{};
+  PiecePositions deepest_{};
+  /// The effects of the pieces in the running search, which is much smaller than the whole table `kAttackBB`
+  std::vector<AttackRow> attack_rows_{};
+  /// The index in `attack_rows_` of the piece at each depth
+  std::vector<int> attack_row_index_{};
+  /// The original piece at each depth if `PrepareUnreversible` merged pieces (empty otherwise)
+  PCVector labels_{};
+  /// The ranges of depths [first, second) which have different labels for the same piece
+  std::vector<std::pair<int, int>> label_runs_{};
+  /// Whether pawns of each color are placed after every other pawn-like piece of the color
+  bool pawns_last_[ColorNum]{true, true};
+  /// The asymmetric piece type used to break the symmetry of directions in reversible search
+  PieceType flip_pt_{PieceEmpty};
+  /// The minimum number of `flip_pt_` which face upward
+  int flip_need_{0};
+  /// Whether the piece at each depth tries the downward direction first in reversible search
+  std::vector<bool> reverse_first_{};
+  /// The depth where `SearchImpl` stops and records a subproblem (-1 if not splitting)
+  int split_depth_{-1};
+  /// Whether `PrepareUnreversible` merges pieces with the same effects
+  bool merge_pieces_{true};
+  std::vector<Subproblem> subproblems_{};
+  /// The members of `RunBatch` which are neither solved nor pruned at each depth of the running branch
+  std::vector<std::vector<int>> batch_alive_{};
+  /// The counters of the thread running `Run()` (null if `config_.perf_counters` is not set)
+  std::unique_ptr<PerfCounters> perf_counters_{};
+  PerfProfile perf_profile_{};
+  SolutionStats stats_{F, R};
   SearchConfiguration config_;
 };
+
+/// The search engine for the standard 9x9 board
+using Search = BasicSearch<9, 9>;
 }  // namespace komori
 
 #endif  // KOMORI_SEARCH_HPP_
\ No newline at end of file
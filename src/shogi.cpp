@@ -1,6 +1,11 @@
 #include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
 #include <map>
 #include <sstream>
+#include <stdexcept>
 
 #include "shogi.hpp"
 
@@ -23,63 +28,33 @@ constexpr bool kIsPawnLike[komori::PCNum] = {
 }  // namespace
 
 namespace komori {
-const Bitboard kSquareMaskBB[SquareNum] = {
-    Bitboard(u64(1) << 0, 0),  Bitboard(u64(1) << 1, 0),  Bitboard(u64(1) << 2, 0),  Bitboard(u64(1) << 3, 0),
-    Bitboard(u64(1) << 4, 0),  Bitboard(u64(1) << 5, 0),  Bitboard(u64(1) << 6, 0),  Bitboard(u64(1) << 7, 0),
-    Bitboard(u64(1) << 8, 0),  Bitboard(u64(1) << 9, 0),
-
-    Bitboard(u64(1) << 10, 0), Bitboard(u64(1) << 11, 0), Bitboard(u64(1) << 12, 0), Bitboard(u64(1) << 13, 0),
-    Bitboard(u64(1) << 14, 0), Bitboard(u64(1) << 15, 0), Bitboard(u64(1) << 16, 0), Bitboard(u64(1) << 17, 0),
-    Bitboard(u64(1) << 18, 0), Bitboard(u64(1) << 19, 0),
-
-    Bitboard(u64(1) << 20, 0), Bitboard(u64(1) << 21, 0), Bitboard(u64(1) << 22, 0), Bitboard(u64(1) << 23, 0),
-    Bitboard(u64(1) << 24, 0), Bitboard(u64(1) << 25, 0), Bitboard(u64(1) << 26, 0), Bitboard(u64(1) << 27, 0),
-    Bitboard(u64(1) << 28, 0), Bitboard(u64(1) << 29, 0),
-
-    Bitboard(u64(1) << 30, 0), Bitboard(u64(1) << 31, 0), Bitboard(u64(1) << 32, 0), Bitboard(u64(1) << 33, 0),
-    Bitboard(u64(1) << 34, 0), Bitboard(u64(1) << 35, 0), Bitboard(u64(1) << 36, 0), Bitboard(u64(1) << 37, 0),
-    Bitboard(u64(1) << 38, 0), Bitboard(u64(1) << 39, 0),
-
-    Bitboard(u64(1) << 40, 0), Bitboard(u64(1) << 41, 0), Bitboard(u64(1) << 42, 0), Bitboard(u64(1) << 43, 0),
-    Bitboard(u64(1) << 44, 0), Bitboard(u64(1) << 45, 0), Bitboard(u64(1) << 46, 0), Bitboard(u64(1) << 47, 0),
-    Bitboard(u64(1) << 48, 0), Bitboard(u64(1) << 49, 0),
-
-    Bitboard(0, u64(1) << 0),  Bitboard(0, u64(1) << 1),  Bitboard(0, u64(1) << 2),  Bitboard(0, u64(1) << 3),
-    Bitboard(0, u64(1) << 4),  Bitboard(0, u64(1) << 5),  Bitboard(0, u64(1) << 6),  Bitboard(0, u64(1) << 7),
-    Bitboard(0, u64(1) << 8),  Bitboard(0, u64(1) << 9),
-
-    Bitboard(0, u64(1) << 10), Bitboard(0, u64(1) << 11), Bitboard(0, u64(1) << 12), Bitboard(0, u64(1) << 13),
-    Bitboard(0, u64(1) << 14), Bitboard(0, u64(1) << 15), Bitboard(0, u64(1) << 16), Bitboard(0, u64(1) << 17),
-    Bitboard(0, u64(1) << 18), Bitboard(0, u64(1) << 19),
-
-    Bitboard(0, u64(1) << 20), Bitboard(0, u64(1) << 21), Bitboard(0, u64(1) << 22), Bitboard(0, u64(1) << 23),
-    Bitboard(0, u64(1) << 24), Bitboard(0, u64(1) << 25), Bitboard(0, u64(1) << 26), Bitboard(0, u64(1) << 27),
-    Bitboard(0, u64(1) << 28), Bitboard(0, u64(1) << 29),
-
-    Bitboard(0, u64(1) << 30), Bitboard(0, u64(1) << 31), Bitboard(0, u64(1) << 32), Bitboard(0, u64(1) << 33),
-    Bitboard(0, u64(1) << 34), Bitboard(0, u64(1) << 35), Bitboard(0, u64(1) << 36), Bitboard(0, u64(1) << 37),
-    Bitboard(0, u64(1) << 38), Bitboard(0, u64(1) << 39),
-};
-
-const Bitboard AllOneBB =
-    (Bitboard(u64(0x1ff) << 0, 0) | Bitboard(u64(0x1ff) << 10, 0) | Bitboard(u64(0x1ff) << 20, 0) |
-     Bitboard(u64(0x1ff) << 30, 0) | Bitboard(u64(0x1ff) << 40, 0) | Bitboard(0, u64(0x1ff) << 0) |
-     Bitboard(0, u64(0x1ff) << 10) | Bitboard(0, u64(0x1ff) << 20) | Bitboard(0, u64(0x1ff) << 30));
-
-Bitboard kGreaterMaskBB[SquareNum];
-Bitboard kEdge2BB[ColorNum];
-
 namespace {
-bool isInSquare(int file, int rank) {
-  return file >= 0 && file < 9 && rank >= 0 && rank < 9;
-}
+/// Get the piece which `c` represents in sfen (`PieceEmpty` if none)
+PieceType Char2Piece(char c) {
+  switch (c) {
+    case 'X':
+      return Stone;
+    case 'Q':
+      return PieceQueen;
+    default:
+      break;
+  }
 
-bool is_initialized = false;
-}  // namespace
+  constexpr char kPieceChars[] = "PLNSBRGK";
+  const char* pos = std::strchr(kPieceChars, std::toupper(static_cast<unsigned char>(c)));
+  if (c == '\0' || pos == nullptr) {
+    return PieceEmpty;
+  }
+  int pt = static_cast<int>(pos - kPieceChars) + Pawn;
+  return static_cast<PieceType>(std::islower(static_cast<unsigned char>(c)) ? pt | PTWhiteFlag : pt);
+}
 
-Bitboard kAttackBB[PCNum][SquareNum];
+/// Build the tables of the board which has `F` files and `R` ranks
+template <int F, int R>
+void BuildTables() {
+  using Geometry = Board<F, R>;
+  constexpr int kSquareNum = Geometry::kSquareNum;
 
-void InitAttackBB() {
   int dr[PCNum][ColorNum][8] = {
       // Stone
       {{0}, {0}},
@@ -122,26 +97,36 @@ void InitAttackBB() {
       {{-1, 0, 1, -1, 1, -1, 0, 1}, {-1, 0, 1, -1, 1, -1, 0, 1}},
   };
 
-  if (is_initialized) {
-    return;
+  for (Square sq = 0; sq < kSquareNum; ++sq) {
+    if (sq < Geometry::kLane0Num) {
+      kSquareMaskBB<F, R>[sq] = BasicBitboard<F, R>(u64(1) << sq, 0);
+    } else {
+      kSquareMaskBB<F, R>[sq] = BasicBitboard<F, R>(0, u64(1) << (sq - Geometry::kLane0Num));
+    }
+  }
+
+  kAllOneBB<F, R> = allZeroBB<F, R>();
+  for (int r = 0; r < R; ++r) {
+    for (int f = 0; f < F; ++f) {
+      kAllOneBB<F, R> |= SquareMaskBB<F, R>(Geometry::MakeSquare(f, r));
+    }
   }
-  is_initialized = true;
 
   for (int pt = 0; pt < PieceTypeNum; ++pt) {
     for (int color = 0; color < ColorNum; ++color) {
-      for (int r = 0; r < 9; ++r) {
-        for (int f = 0; f < 9; ++f) {
-          int sq = MakeSquare(f, r);
+      for (int r = 0; r < R; ++r) {
+        for (int f = 0; f < F; ++f) {
+          int sq = Geometry::MakeSquare(f, r);
           int pc = pt | (color == Black ? 0 : PTWhiteFlag);
-          kAttackBB[pc][sq] = SquareMaskBB(sq);
+          kAttackBB<F, R>[pc][sq] = SquareMaskBB<F, R>(sq);
           for (int i = 0; i < 8; ++i) {
             if (dr[pt][color][i] == 0 && df[pt][color][i] == 0)
               break;
             int ri = r + dr[pt][color][i];
             int fi = f + df[pt][color][i];
 
-            while (isInSquare(fi, ri)) {
-              kAttackBB[pc][sq] |= SquareMaskBB(MakeSquare(fi, ri));
+            while (Geometry::IsInBoard(fi, ri)) {
+              kAttackBB<F, R>[pc][sq] |= SquareMaskBB<F, R>(Geometry::MakeSquare(fi, ri));
               if (!(pt == Lance || pt == Rook || pt == Bishop))
                 break;
 
@@ -153,31 +138,44 @@ void InitAttackBB() {
       }
     }
   }
-  for (int r = 0; r < 9; ++r) {
-    for (int f = 0; f < 9; ++f) {
-      Square sq = MakeSquare(f, r);
-      kAttackBB[BlackProBishop][sq] = kAttackBB[BlackBishop][sq] | kAttackBB[BlackKing][sq];
-      kAttackBB[BlackProRook][sq] = kAttackBB[BlackRook][sq] | kAttackBB[BlackKing][sq];
-      kAttackBB[WhiteProBishop][sq] = kAttackBB[WhiteBishop][sq] | kAttackBB[WhiteKing][sq];
-      kAttackBB[WhiteProRook][sq] = kAttackBB[WhiteRook][sq] | kAttackBB[WhiteKing][sq];
-      kAttackBB[PieceQueen][sq] = kAttackBB[BlackBishop][sq] | kAttackBB[BlackRook][sq];
+  for (int r = 0; r < R; ++r) {
+    for (int f = 0; f < F; ++f) {
+      Square sq = Geometry::MakeSquare(f, r);
+      auto& attack_bb = kAttackBB<F, R>;
+      attack_bb[BlackProBishop][sq] = attack_bb[BlackBishop][sq] | attack_bb[BlackKing][sq];
+      attack_bb[BlackProRook][sq] = attack_bb[BlackRook][sq] | attack_bb[BlackKing][sq];
+      attack_bb[WhiteProBishop][sq] = attack_bb[WhiteBishop][sq] | attack_bb[WhiteKing][sq];
+      attack_bb[WhiteProRook][sq] = attack_bb[WhiteRook][sq] | attack_bb[WhiteKing][sq];
+      attack_bb[PieceQueen][sq] = attack_bb[BlackBishop][sq] | attack_bb[BlackRook][sq];
+      // Promoted minor pieces move as golds
+      for (PieceType pt : {ProPawn, ProLance, ProKnight, ProSilver}) {
+        attack_bb[pt][sq] = attack_bb[BlackGold][sq];
+        attack_bb[pt | PTWhiteFlag][sq] = attack_bb[WhiteGold][sq];
+      }
     }
   }
 
-  for (Square sq = 0; sq < SquareNum; ++sq) {
-    kGreaterMaskBB[sq] = AllOneBB;
+  for (Square sq = 0; sq < kSquareNum; ++sq) {
+    kGreaterMaskBB<F, R>[sq] = kAllOneBB<F, R>;
     for (Square sq2 = 0; sq2 <= sq; ++sq2) {
-      kGreaterMaskBB[sq] ^= kSquareMaskBB[sq2];
+      kGreaterMaskBB<F, R>[sq] ^= SquareMaskBB<F, R>(sq2) & kAllOneBB<F, R>;
     }
   }
 
-  for (int f = 0; f < 9; ++f) {
-    kEdge2BB[Black] |= kSquareMaskBB[MakeSquare(f, 0)];
-    kEdge2BB[Black] |= kSquareMaskBB[MakeSquare(f, 1)];
-    kEdge2BB[White] |= kSquareMaskBB[MakeSquare(f, 8)];
-    kEdge2BB[White] |= kSquareMaskBB[MakeSquare(f, 7)];
+  for (int f = 0; f < F; ++f) {
+    kEdge2BB<F, R>[Black] |= SquareMaskBB<F, R>(Geometry::MakeSquare(f, 0));
+    kEdge2BB<F, R>[Black] |= SquareMaskBB<F, R>(Geometry::MakeSquare(f, 1));
+    kEdge2BB<F, R>[White] |= SquareMaskBB<F, R>(Geometry::MakeSquare(f, R - 1));
+    kEdge2BB<F, R>[White] |= SquareMaskBB<F, R>(Geometry::MakeSquare(f, R - 2));
   }
 }
+}  // namespace
+
+template <int F, int R>
+void InitAttackBB() {
+  // The initialization of a static local variable is thread-safe, so the tables are built exactly once
+  [[maybe_unused]] static const bool kBuilt = (BuildTables<F, R>(), true);
+}
 
 const char* UsiString(PieceType pc) {
   const char* usi_table[PCNum] = {"X",  "P",  "L",  "N",  "S",  "B",  "R",  "G",  "K",  "+P", "+L",
@@ -187,19 +185,20 @@ const char* UsiString(PieceType pc) {
   return usi_table[pc];
 }
 
+template <int F, int R>
 std::string Pieces2Sfen(const PiecePositions& pieces) {
   std::ostringstream ss;
   int space = 0;
-  PieceType pcs[SquareNum];
-  std::fill(pcs, pcs + SquareNum, PieceEmpty);
+  PieceType pcs[Board<F, R>::kSquareNum];
+  std::fill(pcs, pcs + Board<F, R>::kSquareNum, PieceEmpty);
 
   for (auto piece : pieces) {
     pcs[piece.sq] = piece.pc;
   }
 
-  for (int r = 0; r < 9; ++r) {
-    for (int f = 0; f < 9; ++f) {
-      int sq = MakeSquare(f, r);
+  for (int r = 0; r < R; ++r) {
+    for (int f = 0; f < F; ++f) {
+      int sq = Board<F, R>::MakeSquare(f, r);
       if (pcs[sq] == PieceEmpty) {
         ++space;
       } else {
@@ -214,13 +213,74 @@ std::string Pieces2Sfen(const PiecePositions& pieces) {
       ss << space;
       space = 0;
     }
-    if (r != 8)
+    if (r != R - 1)
       ss << "/";
   }
   ss << " b - 1";
   return ss.str();
 }
 
+template <int F, int R>
+void Sfen2Pieces(std::string_view sfen, PiecePositions& pieces) {
+  auto broken = [&sfen](const char* what) {
+    return std::runtime_error(std::string{"broken sfen ("} + what + "): " + std::string{sfen});
+  };
+
+  pieces.clear();
+  int file = 0;
+  int rank = 0;
+  bool promote_flag = false;
+  for (std::size_t i = 0; i < sfen.size() && sfen[i] != ' '; ++i) {
+    char c = sfen[i];
+    if (c == '+') {
+      promote_flag = true;
+      continue;
+    }
+    if (promote_flag && !std::isalpha(static_cast<unsigned char>(c))) {
+      throw broken("no piece after +");
+    }
+
+    if (c == '/') {
+      if (file != F || ++rank >= R) {
+        throw broken("wrong board size");
+      }
+      file = 0;
+    } else if (c >= '1' && c <= '9') {
+      int space = 0;
+      for (; i < sfen.size() && std::isdigit(static_cast<unsigned char>(sfen[i])); ++i) {
+        space = space * 10 + (sfen[i] - '0');
+      }
+      --i;
+      file += space;
+    } else {
+      PieceType pc = Char2Piece(c);
+      if (pc == PieceEmpty) {
+        throw broken("unknown piece");
+      }
+      if (promote_flag) {
+        PieceType promoted = Promote(Pc2Pt(pc));
+        if (promoted == Pc2Pt(pc)) {
+          throw broken("unpromotable piece");
+        }
+        pc = static_cast<PieceType>(promoted | (pc & PTWhiteFlag));
+        promote_flag = false;
+      }
+      if (file < F) {
+        pieces.push_back({pc, Board<F, R>::MakeSquare(file, rank)});
+      }
+      ++file;
+    }
+
+    if (file > F) {
+      throw broken("wrong board size");
+    }
+  }
+
+  if (file != F || rank != R - 1 || promote_flag) {
+    throw broken("wrong board size");
+  }
+}
+
 template <Color C>
 bool IsPawnLike(PieceType pc) {
   if constexpr (C == White) {
@@ -300,7 +360,51 @@ std::vector<PieceType> InputParse(std::string in_str) {
   return piecetypes;
 }
 
+template <int F, int R>
+std::string Bitboard2String(const BasicBitboard<F, R>& bb) {
+  std::string str;
+  for (int i = 0; i < BasicBitboard<F, R>::kLaneNum; ++i) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s%016" PRIx64, i > 0 ? ":" : "", bb.p(i));
+    str += buf;
+  }
+  return str;
+}
+
+template <int F, int R>
+BasicBitboard<F, R> String2Bitboard(const std::string& str) {
+  BasicBitboard<F, R> bb = allZeroBB<F, R>();
+  std::istringstream ss(str);
+  std::string lane;
+  for (int i = 0; i < BasicBitboard<F, R>::kLaneNum; ++i) {
+    if (!std::getline(ss, lane, ':') || lane.empty()) {
+      throw std::runtime_error("broken bitboard: " + str);
+    }
+    bb.set(i, std::stoull(lane, nullptr, 16));
+  }
+  return bb;
+}
+
 // explicit instanciation
 template bool IsPawnLike<Black>(PieceType pc);
 template bool IsPawnLike<White>(PieceType pc);
+
+#define KOMORI_INSTANTIATE(F, R)                                                  \
+  template void InitAttackBB<F, R>();                                             \
+  template std::string Pieces2Sfen<F, R>(const PiecePositions& pieces);           \
+  template void Sfen2Pieces<F, R>(std::string_view sfen, PiecePositions& pieces); \
+  template std::string Bitboard2String<F, R>(const BasicBitboard<F, R>& bb);      \
+  template BasicBitboard<F, R> String2Bitboard<F, R>(const std::string& str);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+
+namespace {
+/// Build every table before `main`, so that the tables are never written while searching
+[[maybe_unused]] const bool kTablesBuilt = [] {
+#define KOMORI_INIT(F, R) InitAttackBB<F, R>();
+  KOMORI_FOR_EACH_BOARD(KOMORI_INIT)
+#undef KOMORI_INIT
+  return true;
+}();
+}  // namespace
 }  // namespace komori
\ No newline at end of file
@@ -4,14 +4,13 @@
 #include <immintrin.h>
 #include <cinttypes>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace komori {
 using u64 = std::uint64_t;
 /// Square in the board
 using Square = int;
-/// Row==0 is a dummy row, which simplify the calculation of effects of edge pawns
-constexpr int SquareNum = (9 + 1) * 10;
 
 /// Count the number of 1s
 inline int Count1s(u64 x) {
@@ -23,14 +22,42 @@ inline int FirstOneFromLSB(const u64 b) {
   return __builtin_ctzll(b);
 }
 
-/// Calculate square from a file and a rank
-inline Square MakeSquare(int file, int rank) {
-  return rank + file * 10;
+/// Get the most significant bit (MSB)
+inline int FirstOneFromMSB(const u64 b) {
+  return 63 - __builtin_clzll(b);
 }
 
-inline int GetRank(Square sq) {
-  return sq % 10;
-}
+/**
+ * @brief The geometry of a board which has `F` files and `R` ranks
+ *
+ * Squares are numbered file by file. Each file has a dummy rank after the last rank, which simplify the calculation of
+ * effects of edge pawns.
+ */
+template <int F, int R>
+struct Board {
+  static constexpr int kFileNum = F;
+  static constexpr int kRankNum = R;
+  /// The distance between the same rank of adjacent files (including the dummy rank)
+  static constexpr int kStride = R + 1;
+  static constexpr int kSquareNum = F * kStride;
+  /// The number of u64 needed to represent a bitboard
+  static constexpr int kLaneNum = kSquareNum <= 64 ? 1 : 2;
+  /// The number of squares (including dummies) in the first u64
+  static constexpr int kLane0Num = kLaneNum == 1 ? kSquareNum : (F + 1) / 2 * kStride;
+
+  static_assert(F > 0 && R >= 2, "the board is too small");
+  static_assert(kLane0Num <= 64 && kSquareNum - kLane0Num <= 64, "the board is too large");
+
+  /// Calculate square from a file and a rank
+  static constexpr Square MakeSquare(int file, int rank) { return rank + file * kStride; }
+  static constexpr int GetRank(Square sq) { return sq % kStride; }
+  static constexpr int GetFile(Square sq) { return sq / kStride; }
+  /// Judge if (`file`, `rank`) is in the board
+  static constexpr bool IsInBoard(int file, int rank) { return file >= 0 && file < F && rank >= 0 && rank < R; }
+};
+
+/// Calls `X(F, R)` for every board size compiled into the binary
+#define KOMORI_FOR_EACH_BOARD(X) X(9, 9) X(6, 6) X(5, 6) X(5, 5) X(3, 4)
 
 // <pieces>
 /**
@@ -152,6 +179,11 @@ inline PieceType Pc2Pt(PieceType pc) {
   return pc != PieceQueen ? static_cast<PieceType>(pc & ~PTWhiteFlag) : PieceQueen;
 }
 
+/// The key to compare sets of pieces. The reversible search ignores the directions of pieces and the kinds of golds.
+inline PieceType PieceSetKey(PieceType pc, bool reverse_search) {
+  return reverse_search ? SimplifyGold(Pc2Pt(pc)) : pc;
+}
+
 /// A pair of a piece and a square
 struct PiecePosition {
   PieceType pc{Stone};
@@ -160,81 +192,179 @@ struct PiecePosition {
 /// A vector of `PiecePosition`
 using PiecePositions = std::vector<PiecePosition>;
 /// Get a string representing the board
+template <int F, int R>
 std::string Pieces2Sfen(const PiecePositions& pieces);
+/**
+ * @brief Read the board of `sfen` into `pieces`, which is the inverse of `Pieces2Sfen`
+ *
+ * Only the board part is read and the rest (the side to move, hands, ...) is ignored. `pieces` is overwritten, so that
+ * its storage can be reused among lines. It throws `std::runtime_error` if the board does not fit `F`x`R`.
+ */
+template <int F, int R>
+void Sfen2Pieces(std::string_view sfen, PiecePositions& pieces);
 
 /// Judge if `pc` has an effect on the forwarding square
 template <Color C>
 bool IsPawnLike(PieceType pc);
 // </pieces>
 
-class Bitboard;
-extern const Bitboard kSquareMaskBB[SquareNum];
+namespace detail {
+/// The storage of `BasicBitboard`
+template <int Lanes>
+struct BitboardStorage;
+
+/// A small board fits in a single u64
+template <>
+struct BitboardStorage<1> {
+  u64 p_[1];
+};
+
+template <>
+struct BitboardStorage<2> {
+  union {
+    u64 p_[2];
+    __m128i m_;
+  };
+};
+}  // namespace detail
+
+template <int F, int R>
+class BasicBitboard;
 
-class Bitboard {
+template <int F, int R>
+inline BasicBitboard<F, R> kSquareMaskBB[Board<F, R>::kSquareNum];
+
+/**
+ * @brief A set of squares in a board which has `F` files and `R` ranks
+ *
+ * If the board (including dummy ranks) fits in 64 bits, a bitboard is represented by a single u64. Otherwise, it is
+ * represented by a pair of u64 and calculated by SSE instructions.
+ */
+template <int F, int R>
+class BasicBitboard : private detail::BitboardStorage<Board<F, R>::kLaneNum> {
  public:
-  Bitboard& operator=(const Bitboard& rhs) {
-    _mm_store_si128(&this->m_, rhs.m_);
+  using Geometry = Board<F, R>;
+  static constexpr int kLaneNum = Geometry::kLaneNum;
+  static constexpr bool kIsSingle = kLaneNum == 1;
+
+  BasicBitboard& operator=(const BasicBitboard& rhs) {
+    if constexpr (kIsSingle) {
+      this->p_[0] = rhs.p_[0];
+    } else {
+      _mm_store_si128(&this->m_, rhs.m_);
+    }
     return *this;
   }
-  Bitboard(const Bitboard& bb) { _mm_store_si128(&this->m_, bb.m_); }
-  Bitboard() {}
-  Bitboard(const u64 v0, const u64 v1) {
+  BasicBitboard(const BasicBitboard& bb) { *this = bb; }
+  BasicBitboard() = default;
+  BasicBitboard(const u64 v0, const u64 v1) {
     this->p_[0] = v0;
-    this->p_[1] = v1;
+    if constexpr (!kIsSingle) {
+      this->p_[1] = v1;
+    }
+  }
+  u64 p(const int index) const { return index < kLaneNum ? this->p_[index] : 0; }
+  void set(const int index, const u64 val) { this->p_[index] = val; }
+  explicit operator bool() const {
+    if constexpr (kIsSingle) {
+      return this->p_[0] != 0;
+    } else {
+      return !(_mm_testz_si128(this->m_, _mm_set1_epi8(static_cast<char>(0xffu))));
+    }
   }
-  u64 p(const int index) const { return p_[index]; }
-  void set(const int index, const u64 val) { p_[index] = val; }
-  explicit operator bool() const { return !(_mm_testz_si128(this->m_, _mm_set1_epi8(static_cast<char>(0xffu)))); }
   bool isAny() const { return static_cast<bool>(*this); }
   // これはコードが見難くなるけど仕方ない。
-  bool andIsAny(const Bitboard& bb) const { return !(_mm_testz_si128(this->m_, bb.m_)); }
-  Bitboard operator~() const {
-    Bitboard tmp;
-    _mm_store_si128(&tmp.m_, _mm_andnot_si128(this->m_, _mm_set1_epi8(static_cast<char>(0xffu))));
+  bool andIsAny(const BasicBitboard& bb) const {
+    if constexpr (kIsSingle) {
+      return (this->p_[0] & bb.p_[0]) != 0;
+    } else {
+      return !(_mm_testz_si128(this->m_, bb.m_));
+    }
+  }
+  BasicBitboard operator~() const {
+    BasicBitboard tmp;
+    if constexpr (kIsSingle) {
+      tmp.p_[0] = ~this->p_[0];
+    } else {
+      _mm_store_si128(&tmp.m_, _mm_andnot_si128(this->m_, _mm_set1_epi8(static_cast<char>(0xffu))));
+    }
     return tmp;
   }
-  Bitboard operator&=(const Bitboard& rhs) {
-    _mm_store_si128(&this->m_, _mm_and_si128(this->m_, rhs.m_));
+  BasicBitboard operator&=(const BasicBitboard& rhs) {
+    if constexpr (kIsSingle) {
+      this->p_[0] &= rhs.p_[0];
+    } else {
+      _mm_store_si128(&this->m_, _mm_and_si128(this->m_, rhs.m_));
+    }
     return *this;
   }
-  Bitboard operator|=(const Bitboard& rhs) {
-    _mm_store_si128(&this->m_, _mm_or_si128(this->m_, rhs.m_));
+  BasicBitboard operator|=(const BasicBitboard& rhs) {
+    if constexpr (kIsSingle) {
+      this->p_[0] |= rhs.p_[0];
+    } else {
+      _mm_store_si128(&this->m_, _mm_or_si128(this->m_, rhs.m_));
+    }
     return *this;
   }
-  Bitboard operator^=(const Bitboard& rhs) {
-    _mm_store_si128(&this->m_, _mm_xor_si128(this->m_, rhs.m_));
+  BasicBitboard operator^=(const BasicBitboard& rhs) {
+    if constexpr (kIsSingle) {
+      this->p_[0] ^= rhs.p_[0];
+    } else {
+      _mm_store_si128(&this->m_, _mm_xor_si128(this->m_, rhs.m_));
+    }
     return *this;
   }
-  Bitboard operator<<=(const int i) {
-    _mm_store_si128(&this->m_, _mm_slli_epi64(this->m_, i));
+  BasicBitboard operator<<=(const int i) {
+    if constexpr (kIsSingle) {
+      this->p_[0] <<= i;
+    } else {
+      _mm_store_si128(&this->m_, _mm_slli_epi64(this->m_, i));
+    }
     return *this;
   }
-  Bitboard operator>>=(const int i) {
-    _mm_store_si128(&this->m_, _mm_srli_epi64(this->m_, i));
+  BasicBitboard operator>>=(const int i) {
+    if constexpr (kIsSingle) {
+      this->p_[0] >>= i;
+    } else {
+      _mm_store_si128(&this->m_, _mm_srli_epi64(this->m_, i));
+    }
     return *this;
   }
-  Bitboard operator&(const Bitboard& rhs) const { return Bitboard(*this) &= rhs; }
-  Bitboard operator|(const Bitboard& rhs) const { return Bitboard(*this) |= rhs; }
-  Bitboard operator^(const Bitboard& rhs) const { return Bitboard(*this) ^= rhs; }
-  Bitboard operator<<(const int i) const { return Bitboard(*this) <<= i; }
-  Bitboard operator>>(const int i) const { return Bitboard(*this) >>= i; }
-  bool operator==(const Bitboard& rhs) const {
-    return (_mm_testc_si128(_mm_cmpeq_epi8(this->m_, rhs.m_), _mm_set1_epi8(static_cast<char>(0xffu))) ? true : false);
+  BasicBitboard operator&(const BasicBitboard& rhs) const { return BasicBitboard(*this) &= rhs; }
+  BasicBitboard operator|(const BasicBitboard& rhs) const { return BasicBitboard(*this) |= rhs; }
+  BasicBitboard operator^(const BasicBitboard& rhs) const { return BasicBitboard(*this) ^= rhs; }
+  BasicBitboard operator<<(const int i) const { return BasicBitboard(*this) <<= i; }
+  BasicBitboard operator>>(const int i) const { return BasicBitboard(*this) >>= i; }
+  bool operator==(const BasicBitboard& rhs) const {
+    if constexpr (kIsSingle) {
+      return this->p_[0] == rhs.p_[0];
+    } else {
+      return (_mm_testc_si128(_mm_cmpeq_epi8(this->m_, rhs.m_), _mm_set1_epi8(static_cast<char>(0xffu))) ? true
+                                                                                                          : false);
+    }
   }
-  bool operator!=(const Bitboard& rhs) const { return !(*this == rhs); }
+  bool operator!=(const BasicBitboard& rhs) const { return !(*this == rhs); }
   // これはコードが見難くなるけど仕方ない。
-  Bitboard andEqualNot(const Bitboard& bb) {
-    _mm_store_si128(&this->m_, _mm_andnot_si128(bb.m_, this->m_));
+  BasicBitboard andEqualNot(const BasicBitboard& bb) {
+    if constexpr (kIsSingle) {
+      this->p_[0] &= ~bb.p_[0];
+    } else {
+      _mm_store_si128(&this->m_, _mm_andnot_si128(bb.m_, this->m_));
+    }
     return *this;
   }
   // これはコードが見難くなるけど仕方ない。
-  Bitboard notThisAnd(const Bitboard& bb) const {
-    Bitboard tmp;
-    _mm_store_si128(&tmp.m_, _mm_andnot_si128(this->m_, bb.m_));
+  BasicBitboard notThisAnd(const BasicBitboard& bb) const {
+    BasicBitboard tmp;
+    if constexpr (kIsSingle) {
+      tmp.p_[0] = ~this->p_[0] & bb.p_[0];
+    } else {
+      _mm_store_si128(&tmp.m_, _mm_andnot_si128(this->m_, bb.m_));
+    }
     return tmp;
   }
   template <Color C>
-  Bitboard down(void) const {
+  BasicBitboard down(void) const {
     if constexpr (C == Black) {
       return *this << 1;
     } else {
@@ -242,18 +372,20 @@ class Bitboard {
     }
   }
   template <Color C>
-  Bitboard up(void) const {
+  BasicBitboard up(void) const {
     if constexpr (C == Black) {
       return *this >> 1;
     } else {
       return *this << 1;
     }
   }
-  bool isSet(const Square sq) const { return andIsAny(kSquareMaskBB[sq]); }
-  void setBit(const Square sq) { *this |= kSquareMaskBB[sq]; }
-  void clearBit(const Square sq) { andEqualNot(kSquareMaskBB[sq]); }
-  void xorBit(const Square sq) { (*this) ^= kSquareMaskBB[sq]; }
-  void xorBit(const Square sq1, const Square sq2) { (*this) ^= (kSquareMaskBB[sq1] | kSquareMaskBB[sq2]); }
+  bool isSet(const Square sq) const { return andIsAny(kSquareMaskBB<F, R>[sq]); }
+  void setBit(const Square sq) { *this |= kSquareMaskBB<F, R>[sq]; }
+  void clearBit(const Square sq) { andEqualNot(kSquareMaskBB<F, R>[sq]); }
+  void xorBit(const Square sq) { (*this) ^= kSquareMaskBB<F, R>[sq]; }
+  void xorBit(const Square sq1, const Square sq2) {
+    (*this) ^= (kSquareMaskBB<F, R>[sq1] | kSquareMaskBB<F, R>[sq2]);
+  }
   // Bitboard の right 側だけの要素を調べて、最初に 1 であるマスの index を返す。
   // そのマスを 0 にする。
   // Bitboard の right 側が 0 でないことを前提にしている。
@@ -267,7 +399,8 @@ class Bitboard {
   // そのマスを 0 にする。
   // Bitboard の left 側が 0 でないことを前提にしている。
   Square firstOneLeftFromSQ81() {
-    const Square sq = static_cast<Square>(FirstOneFromLSB(this->p(1)) + 50);
+    static_assert(!kIsSingle, "a single u64 bitboard has no left side");
+    const Square sq = static_cast<Square>(FirstOneFromLSB(this->p(1)) + Geometry::kLane0Num);
     // LSB 側の最初の 1 の bit を 0 にする
     this->p_[1] &= this->p(1) - 1;
     return sq;
@@ -278,30 +411,75 @@ class Bitboard {
   // VC++ の _BitScanForward() は入力が 0 のときに 0 を返す仕様なので、
   // 最初に 0 でないか判定するのは少し損。
   Square firstOneFromSQ11() {
-    if (this->p(0))
+    if constexpr (kIsSingle) {
       return firstOneRightFromSQ11();
-    return firstOneLeftFromSQ81();
+    } else {
+      if (this->p(0))
+        return firstOneRightFromSQ11();
+      return firstOneLeftFromSQ81();
+    }
+  }
+  // Bitboard を SQ99 から SQ11 まで調べて、最初に 1 であるマスの index を返す。
+  // そのマスを 0 にする。
+  // Bitboard が allZeroBB() でないことを前提にしている。
+  Square lastOneFromSQ99() {
+    if constexpr (!kIsSingle) {
+      if (this->p(1)) {
+        const Square sq = static_cast<Square>(FirstOneFromMSB(this->p(1)) + Geometry::kLane0Num);
+        this->p_[1] ^= u64{1} << (sq - Geometry::kLane0Num);
+        return sq;
+      }
+    }
+    const Square sq = static_cast<Square>(FirstOneFromMSB(this->p(0)));
+    this->p_[0] ^= u64{1} << sq;
+    return sq;
   }
   // 返す位置を 0 にしないバージョン。
   Square constFirstOneRightFromSQ11() const { return static_cast<Square>(FirstOneFromLSB(this->p(0))); }
-  Square constFirstOneLeftFromSQ81() const { return static_cast<Square>(FirstOneFromLSB(this->p(1)) + 63); }
+  Square constFirstOneLeftFromSQ81() const {
+    return static_cast<Square>(FirstOneFromLSB(this->p(1)) + Geometry::kLane0Num);
+  }
   Square constFirstOneFromSQ11() const {
-    if (this->p(0))
+    if constexpr (kIsSingle) {
       return constFirstOneRightFromSQ11();
-    return constFirstOneLeftFromSQ81();
+    } else {
+      if (this->p(0))
+        return constFirstOneRightFromSQ11();
+      return constFirstOneLeftFromSQ81();
+    }
   }
   // Bitboard の 1 の bit を数える。
-  int popCount() const { return Count1s(p(0)) + Count1s(p(1)); }
+  int popCount() const {
+    if constexpr (kIsSingle) {
+      return Count1s(p(0));
+    } else {
+      return Count1s(p(0)) + Count1s(p(1));
+    }
+  }
   // bit が 1 つだけ立っているかどうかを判定する。
   bool isOneBit() const { return this->popCount() == 1; }
+  /// Get the squares of the `file`-th file, whose i-th bit is the i-th rank
+  u64 fileBits(const int file) const {
+    constexpr int kLane0Files = Geometry::kLane0Num / Geometry::kStride;
+    constexpr u64 kRankMask = (u64{1} << R) - 1;
+    if (kIsSingle || file < kLane0Files) {
+      return (this->p(0) >> (file * Geometry::kStride)) & kRankMask;
+    } else {
+      return (this->p(1) >> ((file - kLane0Files) * Geometry::kStride)) & kRankMask;
+    }
+  }
 
   // for debug
   void printBoard() const {
-    std::printf("   A  B  C  D  E  F  G  H  I\n");
-    for (int r = 0; r < 10; ++r) {
+    std::printf(" ");
+    for (int f = F - 1; f >= 0; --f) {
+      std::printf("  %c", 'A' + (F - 1 - f));
+    }
+    std::putchar('\n');
+    for (int r = 0; r < Geometry::kStride; ++r) {
       std::printf("%d", (r + 1) % 10);
-      for (int f = 9 - 1; f >= 0; --f) {
-        std::printf("  %c", this->isSet(MakeSquare(f, r)) ? 'X' : '.');
+      for (int f = F - 1; f >= 0; --f) {
+        std::printf("  %c", this->isSet(Geometry::MakeSquare(f, r)) ? 'X' : '.');
       }
       std::putchar('\n');
     }
@@ -310,39 +488,59 @@ class Bitboard {
   }
 
   // 指定した位置が Bitboard のどちらの u64 変数の要素か
-  static int part(const Square sq) { return static_cast<int>(MakeSquare(4, 9) < sq); }
-
- private:
-  union {
-    u64 p_[2];
-    __m128i m_;
-  };
+  static int part(const Square sq) { return static_cast<int>(sq >= Geometry::kLane0Num); }
 };
 
-extern const Bitboard AllOneBB;
-extern Bitboard kGreaterMaskBB[SquareNum];
-extern Bitboard kAttackBB[PCNum][SquareNum];
-extern Bitboard kEdge2BB[ColorNum];
+/// The bitboard of the standard 9x9 board
+using Bitboard = BasicBitboard<9, 9>;
+
+template <int F, int R>
+inline BasicBitboard<F, R> kAllOneBB;
+template <int F, int R>
+inline BasicBitboard<F, R> kGreaterMaskBB[Board<F, R>::kSquareNum];
+template <int F, int R>
+inline BasicBitboard<F, R> kAttackBB[PCNum][Board<F, R>::kSquareNum];
+template <int F, int R>
+inline BasicBitboard<F, R> kEdge2BB[ColorNum];
 
-inline Bitboard SquareMaskBB(Square sq) {
-  return kSquareMaskBB[sq];
+template <int F, int R>
+inline BasicBitboard<F, R> SquareMaskBB(Square sq) {
+  return kSquareMaskBB<F, R>[sq];
 }
-inline Bitboard GreaterMask(Square sq) {
-  return kGreaterMaskBB[sq];
+template <int F, int R>
+inline BasicBitboard<F, R> GreaterMask(Square sq) {
+  return kGreaterMaskBB<F, R>[sq];
 }
-inline Bitboard allOneBB() {
-  return AllOneBB;
+template <int F, int R>
+inline BasicBitboard<F, R> allOneBB() {
+  return kAllOneBB<F, R>;
 }
-inline Bitboard allZeroBB() {
-  return Bitboard(0, 0);
+template <int F, int R>
+inline BasicBitboard<F, R> allZeroBB() {
+  return BasicBitboard<F, R>(0, 0);
 }
-inline Bitboard AttackBB(PieceType pc, Square sq) {
-  return kAttackBB[pc][sq];
+template <int F, int R>
+inline BasicBitboard<F, R> AttackBB(PieceType pc, Square sq) {
+  return kAttackBB<F, R>[pc][sq];
 }
-inline Bitboard Edge2BB(Color c) {
-  return kEdge2BB[c];
+template <int F, int R>
+inline BasicBitboard<F, R> Edge2BB(Color c) {
+  return kEdge2BB<F, R>[c];
 }
+/// Get a string of the lanes of `bb` in hexadecimal separated by ':'
+template <int F, int R>
+std::string Bitboard2String(const BasicBitboard<F, R>& bb);
+/// Parse a string written by `Bitboard2String`. It throws `std::runtime_error` if the string is broken.
+template <int F, int R>
+BasicBitboard<F, R> String2Bitboard(const std::string& str);
 
+/**
+ * @brief Initialize the tables of the board which has `F` files and `R` ranks
+ *
+ * The tables are built before `main` starts and never change after that, so it is safe to call this function and to
+ * read the tables from any thread.
+ */
+template <int F, int R>
 void InitAttackBB();
 const char* UsiString(PieceType pc);
 
@@ -0,0 +1,182 @@
+#include "slider_attack.hpp"
+
+#include <stdexcept>
+
+namespace komori {
+namespace {
+/// The direction {file, rank} of each line
+constexpr int kLineDelta[kSliderLineNum][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+/// The number of magic numbers tried for an entry before giving up
+constexpr int kMagicTries = 1 << 20;
+
+/// The lines along which `pc` slides
+int SliderLines(PieceType pc) {
+  switch (Pc2Pt(pc)) {
+    case Lance:
+      return 1 << kLineFile;
+    case Rook:
+    case ProRook:
+      return (1 << kLineFile) | (1 << kLineRank);
+    case Bishop:
+    case ProBishop:
+      return (1 << kLineDiag) | (1 << kLineAntiDiag);
+    case PieceQueen:
+      return (1 << kSliderLineNum) - 1;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Get the effects along `line` from (`file`, `rank`) which stop at the first square of `occupied`
+ *
+ * The effects of the whole line are returned if `occupied` is `allZeroBB()`.
+ */
+template <int F, int R>
+BasicBitboard<F, R> SlowLineAttack(SliderLine line, int file, int rank, const BasicBitboard<F, R>& occupied) {
+  using Geometry = Board<F, R>;
+  BasicBitboard<F, R> attack = allZeroBB<F, R>();
+  for (int sign : {-1, 1}) {
+    int f = file + sign * kLineDelta[line][0];
+    int r = rank + sign * kLineDelta[line][1];
+    while (Geometry::IsInBoard(f, r)) {
+      Square to = Geometry::MakeSquare(f, r);
+      attack |= SquareMaskBB<F, R>(to);
+      if (occupied.isSet(to)) {
+        break;
+      }
+      f += sign * kLineDelta[line][0];
+      r += sign * kLineDelta[line][1];
+    }
+  }
+  return attack;
+}
+
+/// xorshift64*. The seed is fixed so that every run builds the same tables.
+u64 NextRandom(u64& state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+
+/// Find the magic numbers of `entry` which map every occupancy to a slot holding its effects
+template <int F, int R>
+void FindMagic(SliderEntry<F, R>& entry,
+               int bits,
+               const std::vector<BasicBitboard<F, R>>& occupancies,
+               const std::vector<BasicBitboard<F, R>>& attacks,
+               u64& random_state,
+               std::vector<BasicBitboard<F, R>>& magic_attacks) {
+  int size = 1 << bits;
+  std::vector<bool> filled(size);
+  // A shift of 64 is undefined, so an empty mask uses a zero magic number and shifts by 63 instead
+  entry.shift = bits > 0 ? 64 - bits : 63;
+  for (int i = 0; i < kMagicTries; ++i) {
+    entry.magic[0] = NextRandom(random_state) & NextRandom(random_state) & NextRandom(random_state);
+    entry.magic[1] = NextRandom(random_state) & NextRandom(random_state) & NextRandom(random_state);
+    std::fill(filled.begin(), filled.end(), false);
+    bool ok = true;
+    for (std::size_t j = 0; j < occupancies.size() && ok; ++j) {
+      int index = MagicIndex(entry, occupancies[j]);
+      if (!filled[index - entry.offset]) {
+        filled[index - entry.offset] = true;
+        magic_attacks[index] = attacks[j];
+      } else {
+        ok = magic_attacks[index] == attacks[j];
+      }
+    }
+    if (ok) {
+      return;
+    }
+  }
+  throw std::runtime_error("no magic number is found");
+}
+
+template <int F, int R>
+void BuildSliderTable() {
+  using Geometry = Board<F, R>;
+  using Bitboard = BasicBitboard<F, R>;
+  InitAttackBB<F, R>();
+  auto& table = kSliderTable<F, R>;
+  u64 random_state = 0x9e3779b97f4a7c15ULL;
+
+  int offset = 0;
+  for (int line = 0; line < kSliderLineNum; ++line) {
+    for (Square sq = 0; sq < Geometry::kSquareNum; ++sq) {
+      int file = Geometry::GetFile(sq);
+      int rank = Geometry::GetRank(sq);
+      auto& entry = table.entries[line][sq];
+      entry.offset = offset;
+
+      // The squares at both ends are effected whether they are occupied or not
+      std::vector<Square> squares;
+      entry.mask = allZeroBB<F, R>();
+      if (rank < R) {
+        Bitboard whole = SlowLineAttack<F, R>(SliderLine(line), file, rank, allZeroBB<F, R>());
+        while (whole.isAny()) {
+          Square to = whole.firstOneFromSQ11();
+          int f = Geometry::GetFile(to) + kLineDelta[line][0];
+          int r = Geometry::GetRank(to) + kLineDelta[line][1];
+          int back_f = Geometry::GetFile(to) - kLineDelta[line][0];
+          int back_r = Geometry::GetRank(to) - kLineDelta[line][1];
+          if (Geometry::IsInBoard(f, r) && Geometry::IsInBoard(back_f, back_r)) {
+            squares.push_back(to);
+            entry.mask |= SquareMaskBB<F, R>(to);
+          }
+        }
+      }
+      int bits = static_cast<int>(squares.size());
+      entry.lane0_bits = Count1s(entry.mask.p(0));
+
+      // `squares` is in ascending order, so the i-th occupancy is at the index i of PEXT
+      std::vector<Bitboard> occupancies(1 << bits, allZeroBB<F, R>());
+      std::vector<Bitboard> attacks(1 << bits, allZeroBB<F, R>());
+      for (int i = 0; i < (1 << bits); ++i) {
+        for (int j = 0; j < bits; ++j) {
+          if ((i >> j) & 1) {
+            occupancies[i] |= SquareMaskBB<F, R>(squares[j]);
+          }
+        }
+        if (rank < R) {
+          attacks[i] = SlowLineAttack<F, R>(SliderLine(line), file, rank, occupancies[i]);
+        }
+      }
+
+#ifdef __BMI2__
+      table.pext_attacks.insert(table.pext_attacks.end(), attacks.begin(), attacks.end());
+#endif
+      table.magic_attacks.resize(offset + (1 << bits));
+      FindMagic<F, R>(entry, bits, occupancies, attacks, random_state, table.magic_attacks);
+      offset += 1 << bits;
+    }
+  }
+
+  for (int pc = 0; pc < PCNum; ++pc) {
+    table.lines[pc] = SliderLines(PieceType(pc));
+    for (Square sq = 0; sq < Geometry::kSquareNum; ++sq) {
+      Bitboard step = AttackBB<F, R>(PieceType(pc), sq);
+      if (Geometry::GetRank(sq) < R) {
+        for (int line = 0; line < kSliderLineNum; ++line) {
+          if ((table.lines[pc] >> line) & 1) {
+            step.andEqualNot(SlowLineAttack<F, R>(SliderLine(line), Geometry::GetFile(sq), Geometry::GetRank(sq),
+                                                  allZeroBB<F, R>()));
+          }
+        }
+      }
+      table.step[pc][sq] = step;
+    }
+  }
+}
+}  // namespace
+
+template <int F, int R>
+void InitSliderAttack() {
+  // The initialization of a static local variable is thread-safe, so the tables are built exactly once
+  [[maybe_unused]] static const bool kBuilt = (BuildSliderTable<F, R>(), true);
+}
+
+#define KOMORI_INSTANTIATE(F, R) template void InitSliderAttack<F, R>();
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
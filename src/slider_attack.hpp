@@ -0,0 +1,120 @@
+#ifndef KOMORI_SLIDER_ATTACK_HPP_
+#define KOMORI_SLIDER_ATTACK_HPP_
+
+#include <vector>
+
+#include "shogi.hpp"
+
+namespace komori {
+/// The lines which sliding pieces move along
+enum SliderLine {
+  kLineFile,      ///< The squares of the same file
+  kLineRank,      ///< The squares of the same rank
+  kLineDiag,      ///< The diagonal on which the file and the rank increase together
+  kLineAntiDiag,  ///< The diagonal on which the file increases as the rank decreases
+  kSliderLineNum,
+};
+
+/// How the effects along a line from a square are looked up
+template <int F, int R>
+struct SliderEntry {
+  /// The squares of the line which can stop the effects (the line without the square itself and both ends)
+  BasicBitboard<F, R> mask;
+  /// The number of bits of `mask` in the first lane
+  int lane0_bits;
+  /// The magic numbers of the lanes for the fallback without PEXT
+  u64 magic[2];
+  /// The number of bits to shift the product of the magic numbers
+  int shift;
+  /// The first index of the entry in the tables of effects
+  int offset;
+};
+
+/**
+ * @brief The tables of the effects of sliding pieces which stop at the first piece
+ *
+ * The effects along a line depend only on the occupancy of `mask`, which is packed into an index by BMI2 PEXT. Without
+ * BMI2, the index is calculated by multiplying each lane by a magic number found at initialization. Both tables have
+ * `2^popCount(mask)` entries from `offset` for each line and square.
+ */
+template <int F, int R>
+struct SliderTable {
+  static constexpr int kSquareNum = Board<F, R>::kSquareNum;
+
+  SliderEntry<F, R> entries[kSliderLineNum][kSquareNum];
+  /// The effects along a line (without the square itself) indexed by PEXT (empty without BMI2)
+  std::vector<BasicBitboard<F, R>> pext_attacks;
+  /// The effects along a line (without the square itself) indexed by the magic numbers
+  std::vector<BasicBitboard<F, R>> magic_attacks;
+  /// The effects of each piece which are not along the lines it slides (including the square itself)
+  BasicBitboard<F, R> step[PCNum][kSquareNum];
+  /// The lines along which each piece slides (the bit `1 << line` for each `SliderLine`)
+  int lines[PCNum];
+};
+
+template <int F, int R>
+inline SliderTable<F, R> kSliderTable;
+
+/**
+ * @brief Build `kSliderTable<F, R>`. It is thread-safe in the same way as `InitAttackBB`.
+ *
+ * The tables are built on the first call, not before `main`, because only the benchmark uses them to cross-check
+ * `AttackBB`.
+ * It throws `std::runtime_error` if no magic number is found, which never happens for the supported boards.
+ */
+template <int F, int R>
+void InitSliderAttack();
+
+#ifdef __BMI2__
+/// The index of `occupied` in `SliderTable::pext_attacks`
+template <int F, int R>
+inline int PextIndex(const SliderEntry<F, R>& entry, const BasicBitboard<F, R>& occupied) {
+  u64 index = _pext_u64(occupied.p(0), entry.mask.p(0));
+  if constexpr (!BasicBitboard<F, R>::kIsSingle) {
+    index |= _pext_u64(occupied.p(1), entry.mask.p(1)) << entry.lane0_bits;
+  }
+  return entry.offset + static_cast<int>(index);
+}
+#endif
+
+/// The index of `occupied` in `SliderTable::magic_attacks`
+template <int F, int R>
+inline int MagicIndex(const SliderEntry<F, R>& entry, const BasicBitboard<F, R>& occupied) {
+  u64 product = (occupied.p(0) & entry.mask.p(0)) * entry.magic[0];
+  if constexpr (!BasicBitboard<F, R>::kIsSingle) {
+    product ^= (occupied.p(1) & entry.mask.p(1)) * entry.magic[1];
+  }
+  return entry.offset + static_cast<int>(product >> entry.shift);
+}
+
+/// Get the effects along `line` from `sq`, which stop at the first square of `occupied` in each direction
+template <int F, int R>
+inline BasicBitboard<F, R> LineAttackBB(SliderLine line, Square sq, const BasicBitboard<F, R>& occupied) {
+  const auto& table = kSliderTable<F, R>;
+  const auto& entry = table.entries[line][sq];
+#ifdef __BMI2__
+  return table.pext_attacks[PextIndex(entry, occupied)];
+#else
+  return table.magic_attacks[MagicIndex(entry, occupied)];
+#endif
+}
+
+/**
+ * @brief Get the effects of `pc` at `sq` which stop at the first piece of `occupied` (including the square itself)
+ *
+ * It is the same as `AttackBB` if `occupied` has no piece on the lines of `pc`. `InitSliderAttack<F, R>()` must be
+ * called before.
+ */
+template <int F, int R>
+inline BasicBitboard<F, R> BlockedAttackBB(PieceType pc, Square sq, const BasicBitboard<F, R>& occupied) {
+  const auto& table = kSliderTable<F, R>;
+  BasicBitboard<F, R> attack = table.step[pc][sq];
+  for (int lines = table.lines[pc]; lines != 0; lines &= lines - 1) {
+    attack |= LineAttackBB<F, R>(SliderLine(FirstOneFromLSB(lines)), sq, occupied);
+  }
+  // A lance effects only the forward half of its file
+  return attack & AttackBB<F, R>(pc, sq);
+}
+}  // namespace komori
+
+#endif  // KOMORI_SLIDER_ATTACK_HPP_
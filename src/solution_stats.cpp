@@ -0,0 +1,62 @@
+#include "solution_stats.hpp"
+
+#include <sstream>
+
+namespace komori {
+void SolutionStats::Merge(const SolutionStats& other) {
+  solutions += other.solutions;
+  for (std::size_t i = 0; i < occupancy.size(); ++i) {
+    occupancy[i] += other.occupancy[i];
+  }
+  for (std::size_t i = 0; i < free_squares.size(); ++i) {
+    free_squares[i] += other.free_squares[i];
+  }
+}
+
+std::string SolutionStats2Json(const SolutionStats& stats) {
+  std::vector<int> placed;
+  for (int pc = 0; pc < PCNum; ++pc) {
+    for (int sq = 0; sq < stats.file_num * stats.rank_num; ++sq) {
+      if (stats.occupancy[pc * stats.file_num * stats.rank_num + sq] > 0) {
+        placed.push_back(pc);
+        break;
+      }
+    }
+  }
+
+  std::ostringstream ss;
+  ss << "{\"board\":\"" << stats.file_num << "x" << stats.rank_num << "\",\"solutions\":" << stats.solutions;
+  ss << ",\"occupancy\":{";
+  for (std::size_t i = 0; i < placed.size(); ++i) {
+    ss << (i > 0 ? "," : "") << "\"" << UsiString(PieceType(placed[i])) << "\":[";
+    for (int rank = 0; rank < stats.rank_num; ++rank) {
+      ss << (rank > 0 ? ",[" : "[");
+      for (int file = 0; file < stats.file_num; ++file) {
+        ss << (file > 0 ? "," : "") << stats.Occupancy(PieceType(placed[i]), file, rank);
+      }
+      ss << "]";
+    }
+    ss << "]";
+  }
+
+  ss << "},\"edge\":{";
+  for (std::size_t i = 0; i < placed.size(); ++i) {
+    u64 edge = 0;
+    for (int rank = 0; rank < stats.rank_num; ++rank) {
+      for (int file = 0; file < stats.file_num; ++file) {
+        if (rank == 0 || rank == stats.rank_num - 1 || file == 0 || file == stats.file_num - 1) {
+          edge += stats.Occupancy(PieceType(placed[i]), file, rank);
+        }
+      }
+    }
+    ss << (i > 0 ? "," : "") << "\"" << UsiString(PieceType(placed[i])) << "\":" << edge;
+  }
+
+  ss << "},\"free_squares\":[";
+  for (std::size_t n = 0; n < stats.free_squares.size(); ++n) {
+    ss << (n > 0 ? "," : "") << stats.free_squares[n];
+  }
+  ss << "]}";
+  return ss.str();
+}
+}  // namespace komori
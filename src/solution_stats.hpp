@@ -0,0 +1,50 @@
+#ifndef KOMORI_SOLUTION_STATS_HPP_
+#define KOMORI_SOLUTION_STATS_HPP_
+
+#include <string>
+#include <vector>
+
+#include "shogi.hpp"
+
+namespace komori {
+/**
+ * @brief Aggregates over placements which are counted without being stored
+ *
+ * Every count is a number of placements. Squares are numbered in the order of SFEN, i.e. `rank * file_num + file`
+ * where `file` 0 is the leftmost file.
+ */
+struct SolutionStats {
+  SolutionStats(void) = default;
+  SolutionStats(int file_num, int rank_num)
+      : file_num{file_num},
+        rank_num{rank_num},
+        occupancy(PCNum * file_num * rank_num, 0),
+        free_squares(file_num * rank_num + 1, 0) {}
+
+  /// The number of placements which have `pc` at (`file`, `rank`)
+  u64& Occupancy(PieceType pc, int file, int rank) { return occupancy[(pc * rank_num + rank) * file_num + file]; }
+  u64 Occupancy(PieceType pc, int file, int rank) const {
+    return occupancy[(pc * rank_num + rank) * file_num + file];
+  }
+  /// Add the counts of `other`, which must be of the same board
+  void Merge(const SolutionStats& other);
+
+  int file_num{0};
+  int rank_num{0};
+  u64 solutions{0};
+  /// The counts of `Occupancy()` of every piece and square
+  std::vector<u64> occupancy{};
+  /// `free_squares[n]` is the number of placements which leave `n` empty squares effected by no piece
+  std::vector<u64> free_squares{};
+};
+
+/**
+ * @brief Get a JSON object of `stats` in a line
+ *
+ * "occupancy" has a table of ranks and files for each piece placed at least once, and "edge" has the number of times
+ * each piece is on an edge of the board (summed over placements and pieces).
+ */
+std::string SolutionStats2Json(const SolutionStats& stats);
+}  // namespace komori
+
+#endif  // KOMORI_SOLUTION_STATS_HPP_
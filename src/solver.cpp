@@ -0,0 +1,70 @@
+#include "solver.hpp"
+
+#include <stdexcept>
+
+#include "shogi.hpp"
+
+namespace komori {
+namespace {
+template <int F, int R>
+SolveResult SolveImpl(const PCVector& pc_list, SearchConfiguration config) {
+  // A callback that returns false stops the search, but the search is regarded as complete
+  bool accepted = false;
+  if (config.on_solution) {
+    config.on_solution = [&accepted, on_solution = std::move(config.on_solution)](const std::string& sfen) {
+      accepted = !on_solution(sfen);
+      return !accepted;
+    };
+  }
+
+  BasicSearch<F, R> search(config);
+  SolveResult result;
+  result.found_cnt = search.Run(pc_list);
+  result.node_count = search.NodeCount();
+  result.sfens = search.AnsSfens();
+  if (search.NodeLimitReached() && !accepted) {
+    result.status = SolveStatus::kInterrupted;
+  } else {
+    result.status = result.found_cnt > 0 ? SolveStatus::kFound : SolveStatus::kNotFound;
+  }
+  return result;
+}
+
+bool IsSupported(int file_num, int rank_num) {
+#define KOMORI_SUPPORTED(F, R)          \
+  if (file_num == F && rank_num == R) { \
+    return true;                        \
+  }
+  KOMORI_FOR_EACH_BOARD(KOMORI_SUPPORTED)
+#undef KOMORI_SUPPORTED
+  return false;
+}
+}  // namespace
+
+Solver::Solver(const SolverOptions& options) : options_{options} {
+  if (!IsSupported(options.file_num, options.rank_num)) {
+    throw std::runtime_error("unsupported board size");
+  }
+}
+
+SolveResult Solver::Solve(const std::string& pieces, const SolveControl& control) const {
+  SearchConfiguration config = options_.config;
+  config.cancel_token = control.cancel_token;
+  config.deadline = control.deadline;
+  config.on_solution = control.on_solution;
+
+  PCVector pc_list = InputParse(pieces);
+  SolveResult result;
+#define KOMORI_DISPATCH(F, R)                             \
+  if (options_.file_num == F && options_.rank_num == R) { \
+    result = SolveImpl<F, R>(pc_list, std::move(config)); \
+  }
+  KOMORI_FOR_EACH_BOARD(KOMORI_DISPATCH)
+#undef KOMORI_DISPATCH
+
+  if (control.on_finish) {
+    control.on_finish(result);
+  }
+  return result;
+}
+}  // namespace komori
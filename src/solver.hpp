@@ -0,0 +1,65 @@
+#ifndef KOMORI_SOLVER_HPP_
+#define KOMORI_SOLVER_HPP_
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+
+namespace komori {
+enum class SolveStatus {
+  /// At least one placement is found
+  kFound,
+  /// It is proved that no placement exists
+  kNotFound,
+  /// The search was stopped by the node limit, the deadline or the cancellation before it completed
+  kInterrupted,
+};
+
+struct SolveResult {
+  SolveStatus status{SolveStatus::kNotFound};
+  u64 found_cnt{0};
+  u64 node_count{0};
+  /// The placements found (empty if `SolveControl::on_solution` is set)
+  std::vector<std::string> sfens{};
+};
+
+/// The settings of a `Solver`, which are shared by all calls of `Solver::Solve`
+struct SolverOptions {
+  int file_num{9};
+  int rank_num{9};
+  /// `cancel_token`, `deadline` and `on_solution` are ignored. Use `SolveControl` instead.
+  SearchConfiguration config{};
+};
+
+/// The settings of a call of `Solver::Solve`
+struct SolveControl {
+  CancellationToken cancel_token{};
+  std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+  /// The function called with each placement found. The search stops when it returns false.
+  std::function<bool(const std::string&)> on_solution{};
+  /// The function called with the result just before `Solve` returns
+  std::function<void(const SolveResult&)> on_finish{};
+};
+
+/**
+ * @brief A reentrant solver for embedding the search in other programs
+ *
+ * `Solve` has no shared mutable state, so any number of calls can run in parallel, even on the same `Solver`.
+ */
+class Solver {
+ public:
+  /// It throws `std::runtime_error` if the board size is not supported.
+  explicit Solver(const SolverOptions& options);
+
+  /// Search placements of `pieces` (e.g. "P18L4N4S4G4K2R2B2"). It throws `std::runtime_error` if the search is invalid.
+  SolveResult Solve(const std::string& pieces, const SolveControl& control = {}) const;
+
+ private:
+  SolverOptions options_;
+};
+}  // namespace komori
+
+#endif  // KOMORI_SOLVER_HPP_
@@ -0,0 +1,93 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+namespace {
+constexpr char kSubproblemTag[] = "subproblem";
+}  // namespace
+
+template <int F, int R>
+std::string Subproblem2String(const BasicSubproblem<F, R>& subproblem) {
+  if (!subproblem.labels.empty()) {
+    throw std::runtime_error("subproblems with merged pieces cannot be written");
+  }
+
+  std::ostringstream ss;
+  ss << kSubproblemTag << " " << F << "x" << R << " ";
+  for (auto pc : subproblem.pc_list) {
+    ss << UsiString(pc);
+  }
+
+  ss << " ";
+  if (subproblem.pieces_log.empty()) {
+    ss << "-";
+  }
+  for (std::size_t i = 0; i < subproblem.pieces_log.size(); ++i) {
+    const auto& piece = subproblem.pieces_log[i];
+    ss << (i > 0 ? "," : "") << UsiString(piece.pc) << ":" << piece.sq;
+  }
+
+  ss << " " << Bitboard2String(subproblem.no_effect_bb) << " " << Bitboard2String(subproblem.pieces_bb);
+  return ss.str();
+}
+
+template <int F, int R>
+BasicSubproblem<F, R> String2Subproblem(const std::string& line) {
+  std::istringstream ss(line);
+  std::string tag, board, pieces, log, no_effect, pieces_bb;
+  if (!(ss >> tag >> board >> pieces >> log >> no_effect >> pieces_bb) || tag != kSubproblemTag) {
+    throw std::runtime_error("broken subproblem: " + line);
+  }
+  if (board != std::to_string(F) + "x" + std::to_string(R)) {
+    throw std::runtime_error("board size mismatch: " + board);
+  }
+
+  BasicSubproblem<F, R> subproblem;
+  subproblem.pc_list = InputParse(pieces);
+  if (log != "-") {
+    std::istringstream log_ss(log);
+    std::string entry;
+    while (std::getline(log_ss, entry, ',')) {
+      auto pos = entry.find(':');
+      PCVector pc = InputParse(entry.substr(0, pos));
+      if (pos == std::string::npos || pc.size() != 1) {
+        throw std::runtime_error("broken subproblem: " + entry);
+      }
+      subproblem.pieces_log.push_back({pc[0], std::stoi(entry.substr(pos + 1))});
+    }
+  }
+  subproblem.no_effect_bb = String2Bitboard<F, R>(no_effect);
+  subproblem.pieces_bb = String2Bitboard<F, R>(pieces_bb);
+
+  // Check if the bitboards are consistent with the placed pieces, in order to detect broken records
+  InitAttackBB<F, R>();
+  BasicBitboard<F, R> expected_no_effect = allOneBB<F, R>();
+  BasicBitboard<F, R> expected_pieces = allZeroBB<F, R>();
+  if (subproblem.pieces_log.size() > subproblem.pc_list.size()) {
+    throw std::runtime_error("broken subproblem: too many placed pieces");
+  }
+  for (std::size_t i = 0; i < subproblem.pieces_log.size(); ++i) {
+    const auto& piece = subproblem.pieces_log[i];
+    if (piece.pc != subproblem.pc_list[i] || piece.sq < 0 || piece.sq >= Board<F, R>::kSquareNum) {
+      throw std::runtime_error("broken subproblem: unexpected piece");
+    }
+    expected_no_effect &= ~AttackBB<F, R>(piece.pc, piece.sq);
+    expected_pieces |= SquareMaskBB<F, R>(piece.sq);
+  }
+  if (expected_no_effect != subproblem.no_effect_bb || expected_pieces != subproblem.pieces_bb) {
+    throw std::runtime_error("broken subproblem: inconsistent bitboards");
+  }
+
+  return subproblem;
+}
+
+// explicit instanciation
+#define KOMORI_INSTANTIATE(F, R)                                                         \
+  template std::string Subproblem2String<F, R>(const BasicSubproblem<F, R>& subproblem); \
+  template BasicSubproblem<F, R> String2Subproblem<F, R>(const std::string& line);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
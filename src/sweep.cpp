@@ -0,0 +1,231 @@
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "screen.hpp"
+
+namespace komori {
+namespace {
+enum QueryStatus { kQueryUnknown = -1, kQueryInfeasible = 0, kQueryFeasible = 1 };
+
+/// A placeable set whose placement is extended by the warm start
+struct Witness {
+  std::vector<int> counts{};
+  std::string sfen{};
+};
+
+template <int F, int R>
+class Sweeper {
+ public:
+  Sweeper(const SearchConfiguration& config,
+          const PCVector& base,
+          const SweepConfiguration& sweep_config,
+          SweepResult& result)
+      : config_{config}, base_{base}, sweep_config_{sweep_config}, result_{result} {
+    config_.all_placement = false;
+    config_.stats = false;
+    config_.on_solution = nullptr;
+  }
+
+  /// Decide if the set of `counts` is placeable. `hint` is a placeable subset (empty `sfen` if none is known).
+  std::pair<QueryStatus, std::string> Query(const std::vector<int>& counts, const Witness& hint) {
+    ++result_.query_cnt;
+    auto [status, sfen] = Decide(counts, hint);
+    if (sweep_config_.on_query) {
+      sweep_config_.on_query(counts, status);
+    }
+    return {status, std::move(sfen)};
+  }
+
+ private:
+  std::pair<QueryStatus, std::string> Decide(const std::vector<int>& counts, const Witness& hint) {
+    PCVector pc_list = base_;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      pc_list.insert(pc_list.end(), counts[i], sweep_config_.ranges[i].pc);
+    }
+
+    if (sweep_config_.screen && ScreenPieces<F, R>(pc_list, config_.reverse_search).infeasible) {
+      ++result_.screened_cnt;
+      return {kQueryInfeasible, {}};
+    }
+
+    if (!hint.sfen.empty() && !config_.reverse_search && sweep_config_.warm_start_nodes > 0) {
+      auto sfen = ExtendWitness(counts, hint);
+      if (!sfen.empty()) {
+        ++result_.warm_start_cnt;
+        return {kQueryFeasible, std::move(sfen)};
+      }
+    }
+
+    ++result_.search_cnt;
+    BasicSearch<F, R> search(config_);
+    int found_cnt = search.Run(pc_list);
+    result_.node_count += search.NodeCount();
+    if (found_cnt > 0) {
+      return {kQueryFeasible, search.AnsSfens()[0]};
+    }
+    return {search.NodeLimitReached() ? kQueryUnknown : kQueryInfeasible, {}};
+  }
+
+  /// Search a placement which keeps the pieces of `hint` where they are. It returns an empty string if none is found.
+  std::string ExtendWitness(const std::vector<int>& counts, const Witness& hint) {
+    BasicSubproblem<F, R> subproblem;
+    Sfen2Pieces<F, R>(hint.sfen, subproblem.pieces_log);
+    subproblem.no_effect_bb = allOneBB<F, R>();
+    subproblem.pieces_bb = allZeroBB<F, R>();
+    for (const auto& piece : subproblem.pieces_log) {
+      subproblem.pc_list.push_back(piece.pc);
+      subproblem.no_effect_bb &= ~AttackBB<F, R>(piece.pc, piece.sq);
+      subproblem.pieces_bb |= SquareMaskBB<F, R>(piece.sq);
+    }
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      subproblem.pc_list.insert(subproblem.pc_list.end(), counts[i] - hint.counts[i], sweep_config_.ranges[i].pc);
+    }
+
+    SearchConfiguration config = config_;
+    config.node_limit = std::min(config.node_limit, sweep_config_.warm_start_nodes);
+    BasicSearch<F, R> search(config);
+    int found_cnt = search.Solve(subproblem);
+    result_.node_count += search.NodeCount();
+    return found_cnt > 0 ? search.AnsSfens()[0] : std::string{};
+  }
+
+  SearchConfiguration config_;
+  const PCVector& base_;
+  const SweepConfiguration& sweep_config_;
+  SweepResult& result_;
+};
+}  // namespace
+
+template <int F, int R>
+SweepResult SweepFrontier(const SearchConfiguration& config,
+                          const PCVector& base,
+                          const SweepConfiguration& sweep_config) {
+  const auto& ranges = sweep_config.ranges;
+  SweepResult result;
+  if (ranges.empty()) {
+    return result;
+  }
+  Sweeper<F, R> sweeper(config, base, sweep_config, result);
+
+  // The threshold is searched along the widest range, and the combinations of the others are the prefixes
+  int last = static_cast<int>(std::max_element(ranges.begin(), ranges.end(),
+                                               [](const SweepRange& l, const SweepRange& r) {
+                                                 return l.max - l.min < r.max - r.min;
+                                               }) -
+                              ranges.begin());
+  const auto& last_range = ranges[last];
+  std::vector<int> strides(ranges.size(), 0);
+  int prefix_num = 1;
+  for (int i = static_cast<int>(ranges.size()) - 1; i >= 0; --i) {
+    if (i != last) {
+      strides[i] = prefix_num;
+      prefix_num *= ranges[i].max - ranges[i].min + 1;
+    }
+  }
+  result.grid_cnt = static_cast<u64>(prefix_num) * (last_range.max - last_range.min + 1);
+
+  // The largest count of `last` proved to be placeable and the largest one not proved to be unplaceable
+  std::vector<int> proved(prefix_num);
+  std::vector<int> possible(prefix_num);
+  std::vector<std::string> witnesses(prefix_num);
+  auto counts_of = [&](int id, int cnt) {
+    std::vector<int> counts(ranges.size());
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+      int width = ranges[i].max - ranges[i].min + 1;
+      counts[i] = static_cast<int>(i) == last ? cnt : ranges[i].min + id / strides[i] % width;
+    }
+    return counts;
+  };
+  // Call `func` with each prefix which has one less piece of a range
+  auto for_each_predecessor = [&](int id, auto&& func) {
+    auto counts = counts_of(id, 0);
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+      if (static_cast<int>(i) != last && counts[i] > ranges[i].min) {
+        func(id - strides[i]);
+      }
+    }
+  };
+
+  for (int id = 0; id < prefix_num; ++id) {
+    // Prefixes with fewer pieces have smaller ids, so the predecessors are already decided
+    int hi = last_range.max;
+    for_each_predecessor(id, [&](int pred) { hi = std::min(hi, possible[pred]); });
+
+    int lo = last_range.min - 1;
+    std::string lo_sfen;
+    int infeasible = hi + 1;
+    // `upper` is the smallest count which is not proved to be placeable
+    int upper = hi + 1;
+    for (bool first = true; upper - lo > 1; first = false) {
+      // The bound itself is tried first because the threshold changes little between neighboring prefixes
+      int cnt = first ? hi : (lo + upper) / 2;
+
+      // The placeable subset with the most pieces is extended by the warm start. The predecessors have one less piece
+      // of their prefixes.
+      Witness hint;
+      int hint_cnt = std::numeric_limits<int>::min();
+      if (lo >= last_range.min) {
+        hint = {counts_of(id, lo), lo_sfen};
+        hint_cnt = lo;
+      }
+      for_each_predecessor(id, [&](int pred) {
+        if (proved[pred] >= last_range.min && proved[pred] <= cnt && proved[pred] - 1 > hint_cnt) {
+          hint = {counts_of(pred, proved[pred]), witnesses[pred]};
+          hint_cnt = proved[pred] - 1;
+        }
+      });
+
+      auto [status, sfen] = sweeper.Query(counts_of(id, cnt), hint);
+      if (status == kQueryFeasible) {
+        lo = cnt;
+        lo_sfen = std::move(sfen);
+      } else {
+        upper = cnt;
+        if (status == kQueryInfeasible) {
+          infeasible = std::min(infeasible, cnt);
+        }
+      }
+    }
+    proved[id] = lo;
+    possible[id] = infeasible - 1;
+    witnesses[id] = std::move(lo_sfen);
+  }
+
+  for (int id = 0; id < prefix_num; ++id) {
+    auto counts = counts_of(id, 0);
+    bool maximal = proved[id] >= last_range.min;
+    bool minimal = possible[id] < last_range.max;
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+      if (static_cast<int>(i) == last) {
+        continue;
+      }
+      if (counts[i] < ranges[i].max && proved[id + strides[i]] >= proved[id]) {
+        maximal = false;
+      }
+      if (counts[i] > ranges[i].min && possible[id - strides[i]] <= possible[id]) {
+        minimal = false;
+      }
+    }
+
+    if (maximal) {
+      result.maximal_feasible.push_back({counts_of(id, proved[id]), witnesses[id]});
+    }
+    if (minimal) {
+      result.minimal_infeasible.push_back({counts_of(id, possible[id] + 1), {}});
+    }
+    for (int cnt = proved[id] + 1; cnt <= possible[id]; ++cnt) {
+      result.unknown.push_back({counts_of(id, cnt), {}});
+    }
+  }
+  return result;
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                                    \
+  template SweepResult SweepFrontier<F, R>(const SearchConfiguration& config, const PCVector& base, \
+                                           const SweepConfiguration& sweep_config);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
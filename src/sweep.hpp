@@ -0,0 +1,77 @@
+#ifndef KOMORI_SWEEP_HPP_
+#define KOMORI_SWEEP_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+/// The counts of a piece added to the base set in `SweepFrontier`
+struct SweepRange {
+  PieceType pc{Stone};
+  int min{0};
+  int max{0};
+};
+
+struct SweepConfiguration {
+  std::vector<SweepRange> ranges{};
+  /// Reject sets by `ScreenPieces` before searching them
+  bool screen{true};
+  /**
+   * @brief The node limit of extending the placement of a smaller set before searching a set
+   *
+   * The extension only finds placements, so a set whose extension fails is searched from scratch. It is not tried in
+   * reversible search.
+   */
+  u64 warm_start_nodes{1 << 16};
+  /// The function called with the counts and the status of each query (1: placeable, 0: not placeable, -1: unknown)
+  std::function<void(const std::vector<int>&, int)> on_query{};
+};
+
+/// A set of the sweep, written as the counts of `SweepConfiguration::ranges`
+struct SweepPoint {
+  std::vector<int> counts{};
+  /// A placement of the set (empty if the set is not placeable)
+  std::string sfen{};
+};
+
+struct SweepResult {
+  /// The placeable sets which have no placeable superset in the ranges
+  std::vector<SweepPoint> maximal_feasible{};
+  /// The sets which are not placeable and have no such subset in the ranges
+  std::vector<SweepPoint> minimal_infeasible{};
+  /// The sets which are neither proved nor refuted within the limits
+  std::vector<SweepPoint> unknown{};
+  /// The number of sets in the ranges
+  u64 grid_cnt{0};
+  /// The number of sets decided without being implied by other sets
+  u64 query_cnt{0};
+  /// The number of queries rejected by `ScreenPieces`
+  u64 screened_cnt{0};
+  /// The number of queries solved by extending a placement of a smaller set
+  u64 warm_start_cnt{0};
+  /// The number of queries searched from scratch
+  u64 search_cnt{0};
+  u64 node_count{0};
+};
+
+/**
+ * @brief Find the frontier between placeable and unplaceable sets of `base` plus the pieces of `ranges`
+ *
+ * Every subset of a placeable set is placeable, so the threshold of the widest range is non-increasing in the counts
+ * of the other ranges. The combinations of the other ranges are visited in lexicographic order, and the threshold of
+ * each is searched below the least threshold of its predecessors: the bound itself first, which is usually placeable,
+ * and then by bisection. Each query tries the screen, then the extension of the placement of the largest known
+ * placeable subset, and then the search with `config`. `config.node_limit` limits each search and `config.deadline`
+ * limits the whole sweep.
+ */
+template <int F, int R>
+SweepResult SweepFrontier(const SearchConfiguration& config,
+                          const PCVector& base,
+                          const SweepConfiguration& sweep_config);
+}  // namespace komori
+
+#endif  // KOMORI_SWEEP_HPP_
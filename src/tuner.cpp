@@ -0,0 +1,84 @@
+#include "tuner.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace komori {
+namespace {
+/// The total number of nodes to search `corpus` with `table`. It gives up as soon as the total exceeds `bound`.
+template <int F, int R>
+u64 Evaluate(SearchConfiguration config,
+             const std::vector<PCVector>& corpus,
+             const std::vector<int>& table,
+             u64 node_limit,
+             u64 bound) {
+  config.order_table = table;
+  u64 cost = 0;
+  for (const auto& pc_list : corpus) {
+    if (cost > bound) {
+      break;
+    }
+    config.node_limit = std::min(node_limit, bound - cost + 1);
+    BasicSearch<F, R> search(config);
+    search.Run(pc_list);
+    cost += search.NodeCount();
+  }
+  return cost;
+}
+}  // namespace
+
+template <int F, int R>
+TuneResult TuneOrderTable(const SearchConfiguration& config,
+                          const std::vector<PCVector>& corpus,
+                          const TuneConfiguration& tune_config) {
+  constexpr u64 kUnbounded = std::numeric_limits<u64>::max() - 1;
+  TuneResult result;
+  result.table = config.order_table.empty() ? DefaultOrderTable() : config.order_table;
+  result.initial_cost = Evaluate<F, R>(config, corpus, result.table, tune_config.node_limit, kUnbounded);
+  result.cost = result.initial_cost;
+
+  // Stones of both colors share the same value, so white stones are not moved separately
+  std::vector<PieceType> pieces;
+  for (const auto& pc_list : corpus) {
+    for (auto pc : pc_list) {
+      PieceType key = Pc2Pt(pc) == Stone ? Stone : pc;
+      if (std::find(pieces.begin(), pieces.end(), key) == pieces.end()) {
+        pieces.push_back(key);
+      }
+    }
+  }
+  if (pieces.size() < 2) {
+    return result;
+  }
+
+  std::mt19937_64 rng(tune_config.seed);
+  for (int iteration = 0; iteration < tune_config.iterations; ++iteration) {
+    PieceType a = pieces[rng() % pieces.size()];
+    PieceType b = pieces[rng() % pieces.size()];
+    if (a == b) {
+      continue;
+    }
+
+    std::vector<int> table = result.table;
+    std::swap(table[a], table[b]);
+    table[Stone | PTWhiteFlag] = table[Stone];
+    u64 cost = Evaluate<F, R>(config, corpus, table, tune_config.node_limit, result.cost);
+    if (cost <= result.cost) {
+      // Ties are accepted to walk across plateaus
+      if (cost < result.cost && tune_config.on_improve) {
+        tune_config.on_improve(iteration, cost);
+      }
+      result.table = std::move(table);
+      result.cost = cost;
+    }
+  }
+  return result;
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                                            \
+  template TuneResult TuneOrderTable<F, R>(const SearchConfiguration& config, const std::vector<PCVector>& corpus, \
+                                           const TuneConfiguration& tune_config);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
@@ -0,0 +1,41 @@
+#ifndef KOMORI_TUNER_HPP_
+#define KOMORI_TUNER_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+struct TuneConfiguration {
+  /// The node limit of each search. A search which reaches it costs the limit.
+  u64 node_limit{1000000};
+  /// The number of candidate tables to try
+  int iterations{200};
+  u64 seed{0};
+  /// The function called with the iteration and the cost whenever a better table is found
+  std::function<void(int, u64)> on_improve{};
+};
+
+struct TuneResult {
+  std::vector<int> table{};
+  /// The total number of nodes of the corpus with the initial table
+  u64 initial_cost{0};
+  /// The total number of nodes of the corpus with `table`
+  u64 cost{0};
+};
+
+/**
+ * @brief Tune the order table of pieces to minimize the total number of nodes to search `corpus`
+ *
+ * It starts from `config.order_table` and repeats swapping the values of two pieces in the corpus (hill climbing which
+ * accepts ties). Only the pieces appearing in the corpus are moved, and the other settings of `config` are used as is.
+ */
+template <int F, int R>
+TuneResult TuneOrderTable(const SearchConfiguration& config,
+                          const std::vector<PCVector>& corpus,
+                          const TuneConfiguration& tune_config);
+}  // namespace komori
+
+#endif  // KOMORI_TUNER_HPP_
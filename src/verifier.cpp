@@ -0,0 +1,144 @@
+#include "verifier.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace komori {
+namespace {
+/// The name of `sq` in the notation of shogi (e.g. "5e")
+template <int F, int R>
+std::string SquareString(Square sq) {
+  std::string str = std::to_string(F - Board<F, R>::GetFile(sq));
+  str += static_cast<char>('a' + Board<F, R>::GetRank(sq));
+  return str;
+}
+
+/// Judge if the first word of `line` is a board
+bool IsBoardLine(std::string_view line) {
+  return line.substr(0, line.find(' ')).find('/') != std::string_view::npos;
+}
+
+/**
+ * @brief Check if `pieces` is a correct placement
+ *
+ * @param expected The number of pieces of each key of `PieceSetKey`
+ * @return Why `pieces` is wrong (empty if it is correct)
+ */
+template <int F, int R>
+std::string CheckPlacement(const PiecePositions& pieces, const int (&expected)[PCNum], bool reverse_search) {
+  int count[PCNum] = {};
+  for (const auto& piece : pieces) {
+    ++count[PieceSetKey(piece.pc, reverse_search)];
+  }
+  for (int key = 0; key < PCNum; ++key) {
+    if (count[key] != expected[key]) {
+      int diff = count[key] - expected[key];
+      return std::to_string(std::abs(diff)) + (diff > 0 ? " extra " : " missing ") + UsiString(PieceType(key));
+    }
+  }
+
+  // Almost every line is correct, so the effects are checked all at once first
+  BasicBitboard<F, R> occupied = allZeroBB<F, R>();
+  BasicBitboard<F, R> effect = allZeroBB<F, R>();
+  for (const auto& piece : pieces) {
+    occupied |= SquareMaskBB<F, R>(piece.sq);
+    effect |= AttackBB<F, R>(piece.pc, piece.sq) & ~SquareMaskBB<F, R>(piece.sq);
+  }
+  if (!(effect & occupied).isAny()) {
+    return {};
+  }
+
+  for (const auto& attacker : pieces) {
+    for (const auto& target : pieces) {
+      if (target.sq != attacker.sq && AttackBB<F, R>(attacker.pc, attacker.sq).isSet(target.sq)) {
+        return std::string{UsiString(attacker.pc)} + " at " + SquareString<F, R>(attacker.sq) + " effects " +
+               UsiString(target.pc) + " at " + SquareString<F, R>(target.sq);
+      }
+    }
+  }
+  return {};
+}
+}  // namespace
+
+template <int F, int R>
+VerifyResult VerifySfens(const std::string& text, const PCVector& pc_list, const VerifyConfiguration& config) {
+  std::vector<std::string_view> lines;
+  for (std::size_t begin = 0; begin < text.size();) {
+    std::size_t end = std::min(text.find('\n', begin), text.size());
+    std::string_view line(text.data() + begin, end - begin);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    lines.push_back(line);
+    begin = end + 1;
+  }
+
+  int expected[PCNum] = {};
+  for (auto pc : pc_list) {
+    ++expected[PieceSetKey(pc, config.reverse_search)];
+  }
+
+  int thread_num = config.thread_num > 0 ? config.thread_num : static_cast<int>(std::thread::hardware_concurrency());
+  thread_num = std::max(thread_num, 1);
+  std::vector<VerifyResult> results(thread_num);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < thread_num; ++i) {
+    threads.emplace_back([&, i] {
+      auto& result = results[i];
+      PiecePositions pieces;
+      std::size_t begin = lines.size() * i / thread_num;
+      std::size_t end = lines.size() * (i + 1) / thread_num;
+      for (std::size_t j = begin; j < end; ++j) {
+        if (!IsBoardLine(lines[j])) {
+          ++result.skip_cnt;
+          continue;
+        }
+
+        std::string reason;
+        try {
+          Sfen2Pieces<F, R>(lines[j], pieces);
+          reason = CheckPlacement<F, R>(pieces, expected, config.reverse_search);
+        } catch (const std::runtime_error& e) {
+          reason = e.what();
+        }
+
+        if (reason.empty()) {
+          ++result.ok_cnt;
+        } else {
+          if (result.ng_cnt == 0) {
+            result.first_ng_line = j + 1;
+            result.first_ng_reason = std::move(reason);
+          }
+          ++result.ng_cnt;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Each thread checks consecutive lines, so the first wrong line is found by the first thread which finds one
+  VerifyResult total;
+  for (const auto& result : results) {
+    total.ok_cnt += result.ok_cnt;
+    total.ng_cnt += result.ng_cnt;
+    total.skip_cnt += result.skip_cnt;
+    if (total.first_ng_line == 0 && result.first_ng_line != 0) {
+      total.first_ng_line = result.first_ng_line;
+      total.first_ng_reason = result.first_ng_reason;
+    }
+  }
+  return total;
+}
+
+#define KOMORI_INSTANTIATE(F, R)                                                            \
+  template VerifyResult VerifySfens<F, R>(const std::string& text, const PCVector& pc_list, \
+                                          const VerifyConfiguration& config);
+KOMORI_FOR_EACH_BOARD(KOMORI_INSTANTIATE)
+#undef KOMORI_INSTANTIATE
+}  // namespace komori
@@ -0,0 +1,41 @@
+#ifndef KOMORI_VERIFIER_HPP_
+#define KOMORI_VERIFIER_HPP_
+
+#include <string>
+
+#include "search.hpp"
+#include "shogi.hpp"
+
+namespace komori {
+struct VerifyConfiguration {
+  /// The number of threads (0 to use every CPU)
+  int thread_num{0};
+  /// Compare the sets of pieces in the same way as the reversible search (see `PieceSetKey`)
+  bool reverse_search{false};
+};
+
+struct VerifyResult {
+  /// The number of correct placements
+  u64 ok_cnt{0};
+  /// The number of wrong placements
+  u64 ng_cnt{0};
+  /// The number of lines which are not placements (e.g. "found 2 solutions")
+  u64 skip_cnt{0};
+  /// The line number (1-origin) of the first wrong placement (0 if every placement is correct)
+  u64 first_ng_line{0};
+  /// Why the first wrong placement is wrong
+  std::string first_ng_reason{};
+};
+
+/**
+ * @brief Check every placement in `text`, which is the output of the search (one sfen per line)
+ *
+ * A placement is correct if it consists of exactly the pieces in `pc_list` and no piece effects another piece. Lines
+ * whose first word is not a board are skipped. Lines are divided among threads, and the result does not depend on the
+ * number of threads.
+ */
+template <int F, int R>
+VerifyResult VerifySfens(const std::string& text, const PCVector& pc_list, const VerifyConfiguration& config);
+}  // namespace komori
+
+#endif  // KOMORI_VERIFIER_HPP_
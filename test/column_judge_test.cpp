@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <tuple>
+
+#include "column_judge.hpp"
+#include "shogi.hpp"
+
+using namespace komori;
+
+namespace {
+/// The numbers of pawn-like pieces, stones and pawn-like pieces which can be lances
+using Counts = std::tuple<int, int, int>;
+
+/**
+ * @brief Enumerate every placement of pawn-like pieces and stones in a file
+ *
+ * A pawn-like piece must not effect the pieces of `occupied` nor the placed pieces, and it can be a lance if no piece
+ * is in front of it in the file. Rank 0 is in front of the other ranks for the pieces facing upward.
+ */
+std::set<Counts> BruteColumn(ColumnKind kind, int rank_num, u64 empty, u64 occupied) {
+  std::set<Counts> counts;
+  int assign_num = 1;
+  for (int r = 0; r < rank_num; ++r) {
+    assign_num *= 4;
+  }
+  for (int assign = 0; assign < assign_num; ++assign) {
+    u64 pawn_b = 0;
+    u64 pawn_w = 0;
+    u64 stone = 0;
+    bool valid = true;
+    for (int r = 0, a = assign; r < rank_num; ++r, a /= 4) {
+      u64 bit = u64{1} << r;
+      if (a % 4 == 0) {
+        continue;
+      } else if ((empty & bit) == 0) {
+        valid = false;
+      }
+      u64& placed = a % 4 == 1 ? stone : a % 4 == 2 ? pawn_b : pawn_w;
+      placed |= bit;
+    }
+    if (!valid || (kind == kColumnBlack && pawn_w != 0) || (kind == kColumnWhite && pawn_b != 0)) {
+      continue;
+    }
+
+    u64 pieces = occupied | pawn_b | pawn_w | stone;
+    if (((pawn_b >> 1) & pieces) != 0 || ((pawn_w << 1) & pieces) != 0) {
+      continue;
+    }
+    int lance = 0;
+    for (int r = 0; r < rank_num; ++r) {
+      u64 bit = u64{1} << r;
+      if (((pawn_b & bit) != 0 && (pieces & (bit - 1)) == 0) || ((pawn_w & bit) != 0 && (pieces >> (r + 1)) == 0)) {
+        ++lance;
+      }
+    }
+    counts.insert({Count1s(pawn_b | pawn_w), Count1s(stone), lance});
+  }
+  return counts;
+}
+
+/// Enumerate every placement in the board by combining the placements in its files
+template <int F, int R>
+std::set<Counts> BruteBoard(ColumnKind kind,
+                            const BasicBitboard<F, R>& no_effect_bb,
+                            const BasicBitboard<F, R>& pieces_bb) {
+  std::set<Counts> counts{{0, 0, 0}};
+  for (int f = 0; f < F; ++f) {
+    std::set<Counts> next;
+    for (const auto& [file_pawn, file_stone, file_lance] :
+         BruteColumn(kind, R, no_effect_bb.fileBits(f), pieces_bb.fileBits(f))) {
+      for (const auto& [pawn, stone, lance] : counts) {
+        next.insert({pawn + file_pawn, stone + file_stone, lance + file_lance});
+      }
+    }
+    counts = std::move(next);
+  }
+  return counts;
+}
+
+/// Make a board whose squares are empty with probability `empty_rate`, and otherwise effected or occupied
+template <int F, int R>
+void RandomBoard(std::mt19937_64& engine,
+                 double empty_rate,
+                 BasicBitboard<F, R>& no_effect_bb,
+                 BasicBitboard<F, R>& pieces_bb) {
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  no_effect_bb = allZeroBB<F, R>();
+  pieces_bb = allZeroBB<F, R>();
+  for (int f = 0; f < F; ++f) {
+    for (int r = 0; r < R; ++r) {
+      Square sq = Board<F, R>::MakeSquare(f, r);
+      double x = dist(engine);
+      if (x < empty_rate) {
+        no_effect_bb.setBit(sq);
+      } else if (x < (1.0 + empty_rate) / 2) {
+        pieces_bb.setBit(sq);
+      }
+    }
+  }
+}
+
+/// Check that `pawn_b`, `pawn_w` and `stone_bb` are a placement of exactly `pawn` and `stone` pieces
+template <int F, int R>
+void ExpectPlacement(const BasicBitboard<F, R>& no_effect_bb,
+                     const BasicBitboard<F, R>& pieces_bb,
+                     int pawn,
+                     int stone,
+                     int lance,
+                     const BasicBitboard<F, R>& pawn_b,
+                     const BasicBitboard<F, R>& pawn_w,
+                     const BasicBitboard<F, R>& stone_bb) {
+  auto placed_bb = pawn_b | pawn_w | stone_bb;
+  EXPECT_FALSE((pawn_b & pawn_w).isAny() || ((pawn_b | pawn_w) & stone_bb).isAny());
+  EXPECT_FALSE((placed_bb & ~no_effect_bb).isAny());
+  EXPECT_EQ((pawn_b | pawn_w).popCount(), pawn);
+  EXPECT_EQ(stone_bb.popCount(), stone);
+
+  auto occupied = pieces_bb | placed_bb;
+  for (auto [pawn_bb, pc] : {std::make_pair(pawn_b, BlackPawn), std::make_pair(pawn_w, WhitePawn)}) {
+    while (pawn_bb.isAny()) {
+      Square sq = pawn_bb.firstOneFromSQ11();
+      bool effects = AttackBB<F, R>(pc, sq).andIsAny(occupied & ~SquareMaskBB<F, R>(sq));
+      EXPECT_FALSE(effects) << "the pawn at " << sq << " effects a piece";
+    }
+  }
+  EXPECT_GE(LanceablePawns(pawn_b, pawn_w, occupied).popCount(), lance);
+}
+
+/// Compare `JudgeColumns` and `GetColumnPlacement` with `BruteBoard` on random boards
+template <int F, int R>
+void CompareWithBruteForce(int board_num) {
+  using Bitboard = BasicBitboard<F, R>;
+  InitAttackBB<F, R>();
+  InitColumnTable<F, R>();
+
+  std::mt19937_64 engine(334);
+  for (int i = 0; i < board_num; ++i) {
+    Bitboard no_effect_bb;
+    Bitboard pieces_bb;
+    RandomBoard(engine, i == 0 ? 1.0 : i % 2 == 0 ? 0.8 : 0.5, no_effect_bb, pieces_bb);
+    for (ColumnKind kind : {kColumnBlack, kColumnWhite, kColumnMixed}) {
+      auto counts = BruteBoard(kind, no_effect_bb, pieces_bb);
+      int max_lance = kind == kColumnMixed ? kColumnMaxLance * F : 0;
+      for (int pawn = 0; pawn <= F * R; ++pawn) {
+        for (int stone = 0; pawn + stone <= F * R; ++stone) {
+          for (int lance = 0; lance <= std::min(pawn, max_lance); ++lance) {
+            auto itr = counts.lower_bound({pawn, stone, lance});
+            bool expected = itr != counts.end() && std::get<0>(*itr) == pawn && std::get<1>(*itr) == stone;
+            SCOPED_TRACE(testing::Message() << "board " << i << ", kind " << kind << ", pawn " << pawn << ", stone "
+                                            << stone << ", lance " << lance);
+            EXPECT_EQ(JudgeColumns(kind, no_effect_bb, pieces_bb, no_effect_bb, pawn, stone, lance), expected);
+
+            if (kind == kColumnMixed) {
+              Bitboard pawn_b, pawn_w, stone_bb;
+              bool found = GetColumnPlacement(no_effect_bb, pieces_bb, pawn, stone, lance, pawn_b, pawn_w, stone_bb);
+              EXPECT_EQ(found, expected);
+              if (found) {
+                ExpectPlacement(no_effect_bb, pieces_bb, pawn, stone, lance, pawn_b, pawn_w, stone_bb);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+}  // namespace
+
+TEST(ColumnJudgeTest, BruteForce34) {
+  CompareWithBruteForce<3, 4>(200);
+}
+
+TEST(ColumnJudgeTest, BruteForce55) {
+  CompareWithBruteForce<5, 5>(100);
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "screen.hpp"
+#include "search.hpp"
+
+using namespace komori;
+
+namespace {
+/// The piece types which random sets are made of
+constexpr PieceType kRandomPieces[] = {Pawn, Lance, Knight, Silver, Gold, Bishop, Rook, King, ProBishop, ProRook};
+
+/**
+ * @brief Check that no set of pieces rejected by `ScreenPieces` is placeable
+ *
+ * The sets are random and have a quarter to a half as many pieces as the squares, so that some of them are placeable
+ * and some of them are rejected.
+ */
+template <int F, int R>
+void ExpectScreenedUnplaceable(bool reverse_search, int set_num) {
+  std::mt19937_64 engine(334);
+  std::uniform_int_distribution<int> size_dist(F * R / 4, F * R / 2);
+  std::uniform_int_distribution<int> piece_dist(0, sizeof(kRandomPieces) / sizeof(kRandomPieces[0]) - 1);
+
+  SearchConfiguration config;
+  config.reverse_search = reverse_search;
+  int screened = 0;
+  for (int i = 0; i < set_num; ++i) {
+    PCVector pc_list;
+    for (int size = size_dist(engine); size > 0; --size) {
+      pc_list.push_back(kRandomPieces[piece_dist(engine)]);
+    }
+    auto screen = ScreenPieces<F, R>(pc_list, reverse_search);
+    if (screen.infeasible) {
+      ++screened;
+      BasicSearch<F, R> search(config);
+      EXPECT_EQ(search.Run(pc_list), 0) << "set " << i << " is placeable: " << screen.reason;
+    }
+  }
+  EXPECT_GT(screened, 0);
+}
+}  // namespace
+
+TEST(ScreenTest, Unplaceable34) {
+  ExpectScreenedUnplaceable<3, 4>(false, 300);
+  ExpectScreenedUnplaceable<3, 4>(true, 300);
+}
+
+TEST(ScreenTest, Unplaceable55) {
+  ExpectScreenedUnplaceable<5, 5>(false, 300);
+  ExpectScreenedUnplaceable<5, 5>(true, 300);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "search.hpp"
+
+using namespace komori;
+
+namespace {
+/// The placements found by solving each subproblem of `--split` with a new search, as separate processes do
+template <int F, int R>
+std::vector<std::string> SolveSplit(const PCVector& pc_list, int depth, int& found_cnt) {
+  SearchConfiguration config;
+  config.all_placement = true;
+  BasicSearch<F, R> splitter(config);
+
+  std::vector<std::string> sfens;
+  found_cnt = 0;
+  for (const auto& subproblem : splitter.Split(pc_list, depth)) {
+    std::string line = Subproblem2String(subproblem);
+    EXPECT_EQ(Subproblem2String(String2Subproblem<F, R>(line)), line);
+
+    BasicSearch<F, R> search(config);
+    found_cnt += search.Solve(String2Subproblem<F, R>(line));
+    EXPECT_FALSE(search.NodeLimitReached());
+    sfens.insert(sfens.end(), search.AnsSfens().begin(), search.AnsSfens().end());
+  }
+  std::sort(sfens.begin(), sfens.end());
+  return sfens;
+}
+
+/// Check that the subproblems written by `Subproblem2String` add up to the placements of `-a`
+template <int F, int R>
+void ExpectSplitSameAsRun(const std::string& pieces) {
+  PCVector pc_list = InputParse(pieces);
+  SearchConfiguration config;
+  config.all_placement = true;
+  BasicSearch<F, R> search(config);
+  int expected_cnt = search.Run(pc_list);
+  std::vector<std::string> expected = search.AnsSfens();
+  std::sort(expected.begin(), expected.end());
+
+  for (int depth = 0; depth <= 2; ++depth) {
+    SCOPED_TRACE(testing::Message() << pieces << " split at depth " << depth);
+    int found_cnt = 0;
+    auto sfens = SolveSplit<F, R>(pc_list, depth, found_cnt);
+    EXPECT_EQ(found_cnt, expected_cnt);
+    EXPECT_EQ(sfens, expected);
+  }
+}
+}  // namespace
+
+TEST(SubproblemTest, SplitSolveMerge34) {
+  ExpectSplitSameAsRun<3, 4>("G2S2");
+  ExpectSplitSameAsRun<3, 4>("KSNLP");
+}
+
+TEST(SubproblemTest, SplitSolveMerge55) {
+  ExpectSplitSameAsRun<5, 5>("G2S2N");
+  ExpectSplitSameAsRun<5, 5>("RB2P2");
+}
+
+TEST(SubproblemTest, BudgetIsShared) {
+  PCVector pc_list = InputParse("G2S2N");
+  SearchConfiguration config;
+  config.all_placement = true;
+  config.node_limit = 1000;
+  BasicSearch<5, 5> splitter(config);
+  auto subproblems = splitter.Split(pc_list, 2);
+
+  // A result stopped by the budget is only a lower bound, which `--solve-subproblem` reports as budget-exhausted
+  BasicSearch<5, 5> search(config);
+  int found_cnt = 0;
+  for (const auto& subproblem : subproblems) {
+    found_cnt += search.Solve(subproblem);
+  }
+  config.node_limit = BasicSearch<5, 5>::Unlimit;
+  BasicSearch<5, 5> unlimited(config);
+  EXPECT_TRUE(search.NodeLimitReached());
+  EXPECT_LT(found_cnt, unlimited.Run(pc_list));
+}